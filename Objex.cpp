@@ -1,395 +1,5362 @@
 #include "Objex.hpp"
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <limits>
+#include <queue>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 1))
+#define OBJEX_USE_SSE
+#include <xmmintrin.h>
+#endif // SSE
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif // NOMINMAX
+#include <windows.h>
+#include <locale.h>
+#else
+#include <fcntl.h>
+#include <locale.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#ifdef __APPLE__
+#include <xlocale.h>
+#endif // __APPLE__
+#endif // _WIN32
+
+namespace
+{
+
+const std::size_t bufferedBlockSize{ 1024u * 1024u }; // 1 MiB
+
+// read-only view of an entire file mapped into memory
+class MappedFile
+{
+public:
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+	MappedFile() { }
+	~MappedFile()
+	{
+		close();
+	}
+
+	bool open(const std::string& filename)
+	{
+		close();
+#ifdef _WIN32
+		mFile = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if (mFile == INVALID_HANDLE_VALUE)
+			return false;
+		LARGE_INTEGER size;
+		if (!GetFileSizeEx(mFile, &size) || (size.QuadPart == 0))
+		{
+			close();
+			return false;
+		}
+		mSize = static_cast<std::size_t>(size.QuadPart);
+		mMapping = CreateFileMappingA(mFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (mMapping == nullptr)
+		{
+			close();
+			return false;
+		}
+		mData = static_cast<const char*>(MapViewOfFile(mMapping, FILE_MAP_READ, 0, 0, 0));
+#else
+		mFile = ::open(filename.c_str(), O_RDONLY);
+		if (mFile == -1)
+			return false;
+		struct stat filestatus;
+		if ((fstat(mFile, &filestatus) != 0) || (filestatus.st_size == 0))
+		{
+			close();
+			return false;
+		}
+		mSize = static_cast<std::size_t>(filestatus.st_size);
+		void* data{ mmap(nullptr, mSize, PROT_READ, MAP_PRIVATE, mFile, 0) };
+		if (data != MAP_FAILED)
+		{
+			madvise(data, mSize, MADV_SEQUENTIAL);
+			mData = static_cast<const char*>(data);
+		}
+#endif // _WIN32
+		if (mData == nullptr)
+		{
+			close();
+			return false;
+		}
+		return true;
+	}
+
+	void close()
+	{
+#ifdef _WIN32
+		if (mData != nullptr)
+			UnmapViewOfFile(mData);
+		if (mMapping != nullptr)
+			CloseHandle(mMapping);
+		if (mFile != INVALID_HANDLE_VALUE)
+			CloseHandle(mFile);
+		mMapping = nullptr;
+		mFile = INVALID_HANDLE_VALUE;
+#else
+		if (mData != nullptr)
+			munmap(const_cast<char*>(mData), mSize);
+		if (mFile != -1)
+			::close(mFile);
+		mFile = -1;
+#endif // _WIN32
+		mData = nullptr;
+		mSize = 0u;
+	}
+
+	const char* getData() const
+	{
+		return mData;
+	}
+
+	std::size_t getSize() const
+	{
+		return mSize;
+	}
+
+private:
+	const char* mData{ nullptr };
+	std::size_t mSize{ 0u };
+#ifdef _WIN32
+	HANDLE mFile{ INVALID_HANDLE_VALUE };
+	HANDLE mMapping{ nullptr };
+#else
+	int mFile{ -1 };
+#endif // _WIN32
+};
+
+inline bool isWhitespace(const char c)
+{
+	return (c == ' ') || (c == '\t') || (c == '\r') || (c == '\f') || (c == '\v');
+}
+
+inline const char* skipWhitespace(const char* begin, const char* end)
+{
+	while ((begin != end) && isWhitespace(*begin))
+		++begin;
+	return begin;
+}
+
+inline const char* trimWhitespaceRight(const char* begin, const char* end)
+{
+	while ((end != begin) && isWhitespace(*(end - 1)))
+		--end;
+	return end;
+}
+
+// finds the next whitespace-separated token and moves the cursor past it. returns false if there are no more tokens
+inline bool nextToken(const char*& cursor, const char* end, const char*& tokenBegin, const char*& tokenEnd)
+{
+	tokenBegin = skipWhitespace(cursor, end);
+	tokenEnd = tokenBegin;
+	while ((tokenEnd != end) && !isWhitespace(*tokenEnd))
+		++tokenEnd;
+	cursor = tokenEnd;
+	return tokenBegin != tokenEnd;
+}
+
+inline bool isKeyword(const char* begin, const char* end, const char* keyword)
+{
+	const std::size_t length{ std::strlen(keyword) };
+	return (static_cast<std::size_t>(end - begin) == length) && std::equal(begin, end, keyword);
+}
+
+inline bool isDigit(const char c)
+{
+	return (c >= '0') && (c <= '9');
+}
+
+// slow path for numbers that the fast path cannot round correctly (very long, very large or very small)
+// strtof rounds the full decimal value once so it is exact even for halfway cases and more than 19 digits. the "C" locale keeps it unaffected by the global locale
+// the range has already been checked against the number grammar. out-of-range values saturate to infinity or zero
+bool parseFloatFallback(const char* begin, const char* end, float& value)
+{
+	const std::string text(begin, end);
+	char* textEnd{ nullptr };
+#ifdef _WIN32
+	static const _locale_t cLocale{ _create_locale(LC_ALL, "C") };
+	value = _strtof_l(text.c_str(), &textEnd, cLocale);
+#else
+	static const locale_t cLocale{ newlocale(LC_ALL_MASK, "C", static_cast<locale_t>(0)) };
+	value = strtof_l(text.c_str(), &textEnd, cLocale);
+#endif // _WIN32
+	return textEnd == text.c_str() + text.size();
+}
+
+// the whole range must be a valid number (decimal, with optional sign, fraction and exponent)
+// numbers made from a mantissa and power of ten that are both exactly representable are calculated with a single (correctly rounded) multiplication or division
+bool parseFloat(const char* begin, const char* end, float& value)
+{
+	static const float floatPowersOfTen[]{ 1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f };
+	static const double doublePowersOfTen[]{ 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+
+	const char* cursor{ begin };
+	bool isNegative{ false };
+	if ((cursor != end) && ((*cursor == '-') || (*cursor == '+')))
+	{
+		isNegative = (*cursor == '-');
+		++cursor;
+	}
+
+	// up to 19 significant digits fit in the mantissa. any more means the fast path cannot be used
+	std::uint64_t mantissa{ 0u };
+	int exponent{ 0 };
+	unsigned int numberOfSignificantDigits{ 0u };
+	bool hasDigits{ false };
+	bool isTruncated{ false };
+	auto addDigit = [&](const char digit, const bool isFraction)
+	{
+		hasDigits = true;
+		if ((mantissa == 0u) && (digit == '0'))
+		{
+			if (isFraction)
+				--exponent;
+			return;
+		}
+		if (numberOfSignificantDigits < 19u)
+		{
+			mantissa = mantissa * 10u + static_cast<unsigned int>(digit - '0');
+			++numberOfSignificantDigits;
+			if (isFraction)
+				--exponent;
+		}
+		else
+		{
+			isTruncated = true;
+			if (!isFraction)
+				++exponent;
+		}
+	};
+	for (; (cursor != end) && isDigit(*cursor); ++cursor)
+		addDigit(*cursor, false);
+	if ((cursor != end) && (*cursor == '.'))
+	{
+		for (++cursor; (cursor != end) && isDigit(*cursor); ++cursor)
+			addDigit(*cursor, true);
+	}
+	if (!hasDigits)
+	{
+		// infinity and nan (any case)
+		std::string word(cursor, end);
+		std::transform(word.begin(), word.end(), word.begin(), [](const char c) { return static_cast<char>(((c >= 'A') && (c <= 'Z')) ? c - 'A' + 'a' : c); });
+		if ((word == "inf") || (word == "infinity"))
+			value = std::numeric_limits<float>::infinity();
+		else if (word == "nan")
+			value = std::numeric_limits<float>::quiet_NaN();
+		else
+			return false;
+		if (isNegative)
+			value = -value;
+		return true;
+	}
+	if ((cursor != end) && ((*cursor == 'e') || (*cursor == 'E')))
+	{
+		++cursor;
+		bool isExponentNegative{ false };
+		if ((cursor != end) && ((*cursor == '-') || (*cursor == '+')))
+		{
+			isExponentNegative = (*cursor == '-');
+			++cursor;
+		}
+		if ((cursor == end) || !isDigit(*cursor))
+			return false;
+		int explicitExponent{ 0 };
+		for (; (cursor != end) && isDigit(*cursor); ++cursor)
+		{
+			if (explicitExponent < 100000)
+				explicitExponent = explicitExponent * 10 + (*cursor - '0');
+		}
+		exponent += isExponentNegative ? -explicitExponent : explicitExponent;
+	}
+	if (cursor != end)
+		return false;
+
+	if (mantissa == 0u)
+	{
+		value = isNegative ? -0.f : 0.f;
+		return true;
+	}
+	if (!isTruncated && (mantissa <= (1u << 24)) && (exponent >= -10) && (exponent <= 10))
+	{
+		value = static_cast<float>(mantissa);
+		value = (exponent < 0) ? value / floatPowersOfTen[-exponent] : value * floatPowersOfTen[exponent];
+		if (isNegative)
+			value = -value;
+		return true;
+	}
+	if (!isTruncated && (mantissa <= (1ull << 53)) && (exponent >= -22) && (exponent <= 22))
+	{
+		double result{ static_cast<double>(mantissa) };
+		result = (exponent < 0) ? result / doublePowersOfTen[-exponent] : result * doublePowersOfTen[exponent];
+
+		// the double is correctly rounded so converting it to float is also correct unless it is exactly halfway between two floats (or in float's subnormal range)
+		std::uint64_t bits;
+		std::memcpy(&bits, &result, sizeof(double));
+		if (((bits & 0x1FFFFFFFull) != 0x10000000ull) && (result >= std::numeric_limits<float>::min()))
+		{
+			value = static_cast<float>(isNegative ? -result : result);
+			return true;
+		}
+	}
+	return parseFloatFallback(begin, end, value);
+}
+
+bool parseInt(const char* begin, const char* end, int& value)
+{
+	bool isNegative{ false };
+	if ((begin != end) && ((*begin == '-') || (*begin == '+')))
+	{
+		isNegative = (*begin == '-');
+		++begin;
+	}
+	if (begin == end)
+		return false;
+	long long result{ 0 };
+	for (; begin != end; ++begin)
+	{
+		if ((*begin < '0') || (*begin > '9'))
+			return false;
+		result = result * 10 + (*begin - '0');
+		if (result > 2147483647)
+			return false;
+	}
+	value = static_cast<int>(isNegative ? -result : result);
+	return true;
+}
+
+// shows percentage of progress. only updates if percentage has increased (whole numbers only)
+void logProgress(const std::string& description, const unsigned long long processed, const unsigned long long total, unsigned int& previousProgress)
+{
+	if (total == 0u)
+		return;
+	const unsigned int progress{ static_cast<unsigned int>(processed * 100u / total) };
+	if (progress > previousProgress)
+		std::clog << description << " " << progress << "%" << std::endl;
+	previousProgress = progress;
+}
+
+// measures time since it was created (or restarted)
+class Stopwatch
+{
+public:
+	Stopwatch()
+		: mStart{ std::chrono::steady_clock::now() }
+	{
+	}
+	double restart() // returns seconds since the last restart
+	{
+		const std::chrono::steady_clock::time_point now{ std::chrono::steady_clock::now() };
+		const double seconds{ std::chrono::duration<double>(now - mStart).count() };
+		mStart = now;
+		return seconds;
+	}
+
+private:
+	std::chrono::steady_clock::time_point mStart;
+};
+
+bool isCancelled(const Objex::LoadOptions& options)
+{
+	return options.cancel && options.cancel->load();
+}
+
+const std::size_t minimumChunkSize{ 64u * 1024u }; // smaller blocks are not worth splitting across threads
+const std::size_t minimumFacesPerTask{ 4096u }; // fewer faces are not worth splitting across threads
+const std::size_t minimumVerticesPerTask{ 4096u };
+
+// zero requests all hardware threads
+unsigned int getNumberOfThreads(const unsigned int requestedNumberOfThreads)
+{
+	if (requestedNumberOfThreads != 0u)
+		return requestedNumberOfThreads;
+	return std::max(std::thread::hardware_concurrency(), 1u);
+}
+
+// calls task(i) for every i in [0, numberOfTasks). tasks are shared between the threads (the calling thread is one of them)
+template <class Task>
+void runInParallel(const std::size_t numberOfTasks, const unsigned int numberOfThreads, const Task& task)
+{
+	if ((numberOfThreads <= 1u) || (numberOfTasks <= 1u))
+	{
+		for (std::size_t i{ 0u }; i < numberOfTasks; ++i)
+			task(i);
+		return;
+	}
+	std::atomic<std::size_t> nextTask{ 0u };
+	auto worker = [&]()
+	{
+		for (std::size_t i{ nextTask++ }; i < numberOfTasks; i = nextTask++)
+			task(i);
+	};
+	std::vector<std::thread> threads;
+	for (unsigned int thread{ 1u }; thread < std::min<std::size_t>(numberOfThreads, numberOfTasks); ++thread)
+		threads.emplace_back(worker);
+	worker();
+	for (auto& thread : threads)
+		thread.join();
+}
+
+// source keeps its capacity so that it can be reused for the next block
+// returns whether the destination was reallocated
+template <class T>
+bool appendMoved(std::vector<T>& destination, std::vector<T>& source)
+{
+	const std::size_t capacity{ destination.capacity() };
+	destination.insert(destination.end(), std::make_move_iterator(source.begin()), std::make_move_iterator(source.end()));
+	return destination.capacity() != capacity;
+}
+
+// a face index that was relative (negative in the file). it is resolved against the counts of the chunk it is in so needs offsetting when merged
+struct RelativeIndex
+{
+	enum class Type : unsigned char
+	{
+		Vertex,
+		Normal,
+		Texture
+	};
+	unsigned int face;
+	unsigned int corner; // position in the chunk's face index lists
+	Type type;
+};
+
+// names (of materials, groups or objects) given to the faces that follow them within a chunk
+struct ChunkFaceNames
+{
+	std::vector<std::string> names; // in order of first use in the chunk
+	std::vector<int> faceNames; // position in names for each face. -1 means the face is before the chunk's first name so continues the name from before the chunk
+	int current{ -1 };
+
+	void setCurrent(const char* begin, const char* end)
+	{
+		const std::string name(begin, end);
+		const auto found = std::find(names.begin(), names.end(), name);
+		current = static_cast<int>(found - names.begin());
+		if (found == names.end())
+			names.push_back(name);
+	}
+
+	void clear()
+	{
+		names.clear();
+		faceNames.clear();
+		current = -1;
+	}
+};
+
+// every name (of one kind) found so far while loading and the one currently given to faces
+struct FaceNameList
+{
+	std::unordered_map<std::string, int> positions;
+	int current{ -1 };
+};
+
+// converts a chunk's names to positions in the full list (adding any new names with addName) and appends them to faceNames
+template <class AddName>
+void mergeFaceNames(ChunkFaceNames& chunkNames, FaceNameList& list, std::vector<int>& faceNames, const AddName& addName)
+{
+	std::vector<int> positions;
+	positions.reserve(chunkNames.names.size());
+	for (auto& name : chunkNames.names)
+	{
+		const auto inserted = list.positions.emplace(name, static_cast<int>(list.positions.size()));
+		positions.push_back(inserted.first->second);
+		if (inserted.second)
+			addName(name);
+	}
+	for (const auto& faceName : chunkNames.faceNames)
+		faceNames.push_back((faceName < 0) ? list.current : positions[faceName]);
+	if (chunkNames.current >= 0)
+		list.current = positions[chunkNames.current];
+}
+
+// the results of parsing a section of the file, independent of any other section
+struct ParsedChunk
+{
+	std::vector<Objex::Vertex> vertices;
+	std::vector<Objex::Vertex> normals;
+	std::vector<Objex::Vertex> textures;
+	std::vector<unsigned int> faceFirstCorners; // start of each face in the index lists (each face ends where the next one starts)
+	std::vector<int> faceVertexIndices;
+	std::vector<int> faceNormalIndices;
+	std::vector<int> faceTextureIndices;
+	std::vector<std::string> commentLines;
+	std::vector<std::string> unprocessedLines;
+	std::vector<RelativeIndex> relativeIndices;
+	ChunkFaceNames materials;
+	ChunkFaceNames groups;
+	ChunkFaceNames objects;
+	std::vector<std::string> materialLibraries;
+	unsigned int numberOfLines{ 0u };
+	unsigned int failedLine{ 0u }; // one-based line number within the chunk (zero if no line failed)
+	std::string failedLineText;
+
+	// empties the chunk but keeps its memory
+	void clear()
+	{
+		vertices.clear();
+		normals.clear();
+		textures.clear();
+		faceFirstCorners.clear();
+		faceVertexIndices.clear();
+		faceNormalIndices.clear();
+		faceTextureIndices.clear();
+		commentLines.clear();
+		unprocessedLines.clear();
+		relativeIndices.clear();
+		materials.clear();
+		groups.clear();
+		objects.clear();
+		materialLibraries.clear();
+		numberOfLines = 0u;
+		failedLine = 0u;
+		failedLineText.clear();
+	}
+};
+
+bool parseVertexLine(const char* begin, const char* end, std::vector<Objex::Vertex>& vertices, const unsigned int minimumNumberOfTokens)
+{
+	// missing components (allowed for texture vertices) are zero and any extra components (e.g. w or vertex colours) are ignored
+	float components[3]{ 0.f, 0.f, 0.f };
+	unsigned int numberOfTokens{ 0u };
+	const char* tokenBegin;
+	const char* tokenEnd;
+	while ((numberOfTokens < 3u) && nextToken(begin, end, tokenBegin, tokenEnd))
+	{
+		if (!parseFloat(tokenBegin, tokenEnd, components[numberOfTokens]))
+			return false;
+		++numberOfTokens;
+	}
+	if (numberOfTokens < minimumNumberOfTokens)
+		return false;
+	vertices.push_back({ components[0], components[1], components[2] });
+	return true;
+}
+
+// adds the face's corners to the end of the chunk's index lists
+bool parseFaceLine(const char* begin, const char* end, ParsedChunk& chunk)
+{
+	const unsigned int faceNumber{ static_cast<unsigned int>(chunk.faceFirstCorners.size()) };
+	const std::size_t firstCorner{ chunk.faceVertexIndices.size() };
+	const std::size_t firstRelativeIndex{ chunk.relativeIndices.size() };
+	std::size_t numberOfNormals{ 0u };
+	std::size_t numberOfTextures{ 0u };
+	const char* tokenBegin{ nullptr };
+	const char* tokenEnd{ nullptr };
+	while (nextToken(begin, end, tokenBegin, tokenEnd))
+	{
+		// token is "v", "v/vt", "v//vn" or "v/vt/vn"
+		const char* indexEnd[3]{ nullptr, nullptr, nullptr };
+		const char* indexBegin[3]{ tokenBegin, nullptr, nullptr };
+		indexEnd[0] = std::find(tokenBegin, tokenEnd, '/');
+		if (indexEnd[0] != tokenEnd)
+		{
+			indexBegin[1] = indexEnd[0] + 1;
+			indexEnd[1] = std::find(indexBegin[1], tokenEnd, '/');
+			if (indexEnd[1] != tokenEnd)
+			{
+				indexBegin[2] = indexEnd[1] + 1;
+				indexEnd[2] = tokenEnd;
+			}
+		}
+
+		// "- 1" converts index from one-based index (in the file) to zero-based index (in an array/vector)
+		// negative indices are relative to the end of the corresponding list (so far)
+		// an index that is not present is -1 (the default)
+		const unsigned int corner{ static_cast<unsigned int>(chunk.faceVertexIndices.size()) };
+		int indexValue{ 0 };
+		if (!parseInt(indexBegin[0], indexEnd[0], indexValue) || (indexValue == 0))
+			return false;
+		if (indexValue < 0)
+		{
+			chunk.relativeIndices.push_back({ faceNumber, corner, RelativeIndex::Type::Vertex });
+			chunk.faceVertexIndices.push_back(static_cast<int>(chunk.vertices.size()) + indexValue);
+		}
+		else
+			chunk.faceVertexIndices.push_back(indexValue - 1);
+		int textureIndex{ -1 };
+		if ((indexBegin[1] != nullptr) && (indexBegin[1] != indexEnd[1])) // texture vertex index is present (second index)
+		{
+			if (!parseInt(indexBegin[1], indexEnd[1], indexValue) || (indexValue == 0))
+				return false;
+			if (indexValue < 0)
+			{
+				chunk.relativeIndices.push_back({ faceNumber, corner, RelativeIndex::Type::Texture });
+				textureIndex = static_cast<int>(chunk.textures.size()) + indexValue;
+			}
+			else
+				textureIndex = indexValue - 1;
+			++numberOfTextures;
+		}
+		chunk.faceTextureIndices.push_back(textureIndex);
+		int normalIndex{ -1 };
+		if ((indexBegin[2] != nullptr) && (indexBegin[2] != indexEnd[2])) // vertex normal index is present (third index)
+		{
+			if (!parseInt(indexBegin[2], indexEnd[2], indexValue) || (indexValue == 0))
+				return false;
+			if (indexValue < 0)
+			{
+				chunk.relativeIndices.push_back({ faceNumber, corner, RelativeIndex::Type::Normal });
+				normalIndex = static_cast<int>(chunk.normals.size()) + indexValue;
+			}
+			else
+				normalIndex = indexValue - 1;
+			++numberOfNormals;
+		}
+		chunk.faceNormalIndices.push_back(normalIndex);
+	}
+
+	// if normals or texture vertices are not provided for each vertex, set them all to the default (index of -1)
+	// normal index of -1 becomes default normal of (0.0, 0.0, 1.0)
+	// texture vertex index of -1 becomes default texture index of (0.0, 0.0, 0.0)
+	const std::size_t numberOfCorners{ chunk.faceVertexIndices.size() - firstCorner };
+	const bool isMissingNormals{ numberOfNormals != numberOfCorners };
+	const bool isMissingTextures{ numberOfTextures != numberOfCorners };
+	if (isMissingNormals)
+		std::fill(chunk.faceNormalIndices.begin() + firstCorner, chunk.faceNormalIndices.end(), -1);
+	if (isMissingTextures)
+		std::fill(chunk.faceTextureIndices.begin() + firstCorner, chunk.faceTextureIndices.end(), -1);
+	if (isMissingNormals || isMissingTextures)
+	{
+		chunk.relativeIndices.erase(std::remove_if(chunk.relativeIndices.begin() + firstRelativeIndex, chunk.relativeIndices.end(), [&](const RelativeIndex& relativeIndex)
+		{
+			return (isMissingNormals && (relativeIndex.type == RelativeIndex::Type::Normal)) || (isMissingTextures && (relativeIndex.type == RelativeIndex::Type::Texture));
+		}), chunk.relativeIndices.end());
+	}
+	return true;
+}
+
+const char defaultGroupName[]{ "default" };
+
+bool parseLine(const char* begin, const char* end, ParsedChunk& chunk)
+{
+	begin = skipWhitespace(begin, end);
+	end = trimWhitespaceRight(begin, end);
+	if (begin == end) // empty line
+		return true;
+
+	const char* cursor{ begin };
+	const char* keywordBegin;
+	const char* keywordEnd;
+	nextToken(cursor, end, keywordBegin, keywordEnd);
+	const std::size_t keywordLength{ static_cast<std::size_t>(keywordEnd - keywordBegin) };
+	if (*keywordBegin == '#')
+		chunk.commentLines.emplace_back(skipWhitespace(begin + 1, end), end);
+	else if ((keywordLength == 1) && (*keywordBegin == 'v'))
+		return parseVertexLine(cursor, end, chunk.vertices, 3u);
+	else if ((keywordLength == 2) && (keywordBegin[0] == 'v') && (keywordBegin[1] == 'n'))
+		return parseVertexLine(cursor, end, chunk.normals, 3u);
+	else if ((keywordLength == 2) && (keywordBegin[0] == 'v') && (keywordBegin[1] == 't'))
+		return parseVertexLine(cursor, end, chunk.textures, 1u);
+	else if ((keywordLength == 1) && (*keywordBegin == 'f'))
+	{
+		const std::size_t firstCorner{ chunk.faceVertexIndices.size() };
+		const std::size_t firstRelativeIndex{ chunk.relativeIndices.size() };
+		if (!parseFaceLine(cursor, end, chunk))
+			return false;
+		if (chunk.faceVertexIndices.size() - firstCorner < 3) // points and lines are not imported
+		{
+			chunk.faceVertexIndices.resize(firstCorner);
+			chunk.faceNormalIndices.resize(firstCorner);
+			chunk.faceTextureIndices.resize(firstCorner);
+			chunk.relativeIndices.resize(firstRelativeIndex);
+			chunk.unprocessedLines.emplace_back(begin, end);
+		}
+		else
+		{
+			chunk.faceFirstCorners.push_back(static_cast<unsigned int>(firstCorner));
+			chunk.materials.faceNames.push_back(chunk.materials.current);
+			chunk.groups.faceNames.push_back(chunk.groups.current);
+			chunk.objects.faceNames.push_back(chunk.objects.current);
+		}
+	}
+	else if (isKeyword(keywordBegin, keywordEnd, "usemtl") && (cursor != end))
+		chunk.materials.setCurrent(skipWhitespace(cursor, end), end);
+	else if ((keywordLength == 1) && (*keywordBegin == 'g'))
+	{
+		// names are not split so a group line with multiple names is one group
+		const char* nameBegin{ skipWhitespace(cursor, end) };
+		if (nameBegin == end)
+			chunk.groups.setCurrent(defaultGroupName, defaultGroupName + std::strlen(defaultGroupName));
+		else
+			chunk.groups.setCurrent(nameBegin, end);
+	}
+	else if ((keywordLength == 1) && (*keywordBegin == 'o'))
+		chunk.objects.setCurrent(skipWhitespace(cursor, end), end);
+	else if (isKeyword(keywordBegin, keywordEnd, "mtllib"))
+	{
+		const char* tokenBegin;
+		const char* tokenEnd;
+		while (nextToken(cursor, end, tokenBegin, tokenEnd))
+			chunk.materialLibraries.emplace_back(tokenBegin, tokenEnd);
+	}
+	else
+		chunk.unprocessedLines.emplace_back(begin, end);
+	return true;
+}
+
+// stops at the first line that cannot be parsed
+void parseLines(const char* begin, const char* end, ParsedChunk& chunk)
+{
+	while (begin != end)
+	{
+		const char* lineEnd{ std::find(begin, end, '\n') };
+		++chunk.numberOfLines;
+		if (!parseLine(begin, lineEnd, chunk))
+		{
+			chunk.failedLine = chunk.numberOfLines;
+			chunk.failedLineText.assign(begin, trimWhitespaceRight(begin, lineEnd));
+			return;
+		}
+		begin = (lineEnd == end) ? end : lineEnd + 1;
+	}
+}
+
+// the combination of indices that makes a vertex unique in indexed output
+struct IndexedCorner
+{
+	int vertex;
+	int texture;
+	int normal;
+	bool operator==(const IndexedCorner& other) const
+	{
+		return (vertex == other.vertex) && (texture == other.texture) && (normal == other.normal);
+	}
+};
+
+struct IndexedCornerHash
+{
+	std::size_t operator()(const IndexedCorner& corner) const
+	{
+		std::size_t hash{ static_cast<std::size_t>(static_cast<unsigned int>(corner.vertex)) };
+		hash = hash * 1000003u ^ static_cast<std::size_t>(static_cast<unsigned int>(corner.texture));
+		hash = hash * 1000003u ^ static_cast<std::size_t>(static_cast<unsigned int>(corner.normal));
+		return hash;
+	}
+};
+
+// index of -1 (or a list with no vertices) uses the default vertex. returns the end of the written vertex
+GLfloat* writeVertex(GLfloat* destination, const std::vector<Objex::Vertex>& vertices, const int index, const Objex::Vertex& defaultVertex)
+{
+	const Objex::Vertex& vertex(((index >= 0) && !vertices.empty()) ? vertices[index] : defaultVertex);
+	destination[0] = vertex.x;
+	destination[1] = vertex.y;
+	destination[2] = vertex.z;
+	return destination + 3;
+}
+
+void appendVertex(std::vector<GLfloat>& destinationArray, const std::vector<Objex::Vertex>& vertices, const int index, const Objex::Vertex& defaultVertex)
+{
+	const Objex::Vertex& vertex(((index >= 0) && !vertices.empty()) ? vertices[index] : defaultVertex);
+	destinationArray.push_back(vertex.x);
+	destinationArray.push_back(vertex.y);
+	destinationArray.push_back(vertex.z);
+}
+
+unsigned int getComponentSize(const Objex::ComponentType componentType)
+{
+	switch (componentType)
+	{
+	case Objex::ComponentType::NormalizedByte:
+	case Objex::ComponentType::NormalizedUnsignedByte:
+		return 1u;
+	case Objex::ComponentType::NormalizedShort:
+	case Objex::ComponentType::NormalizedUnsignedShort:
+	case Objex::ComponentType::HalfFloat:
+		return 2u;
+	case Objex::ComponentType::Float:
+	default:
+		return sizeof(GLfloat);
+	}
+}
+
+template <class T>
+std::size_t getAllocatedSize(const std::vector<T>& vector)
+{
+	return vector.capacity() * sizeof(T);
+}
+
+std::size_t getAllocatedSize(const std::string& string)
+{
+	// short strings are stored inside the string itself
+	const char* const object{ reinterpret_cast<const char*>(&string) };
+	const bool isInside{ (string.data() >= object) && (string.data() < object + sizeof(std::string)) };
+	return isInside ? 0u : string.capacity() + 1u;
+}
+
+std::size_t getAllocatedSize(const std::vector<std::string>& strings)
+{
+	std::size_t size{ strings.capacity() * sizeof(std::string) };
+	for (const auto& string : strings)
+		size += getAllocatedSize(string);
+	return size;
+}
+
+bool isSigned(const Objex::ComponentType componentType)
+{
+	return (componentType == Objex::ComponentType::NormalizedByte) || (componentType == Objex::ComponentType::NormalizedShort);
+}
+
+// rounds to the nearest (even) half. too large is infinity and too small is zero (or subnormal)
+std::uint16_t toHalfFloat(const float value)
+{
+	std::uint32_t bits;
+	std::memcpy(&bits, &value, sizeof(bits));
+	const std::uint16_t sign{ static_cast<std::uint16_t>((bits >> 16) & 0x8000u) };
+	bits &= 0x7fffffffu;
+	if (bits > 0x7f800000u) // NaN
+		return sign | 0x7e00u;
+	if (bits >= 0x477ff000u) // (rounds to) more than the largest half
+		return sign | 0x7c00u;
+	if (bits >= 0x38800000u) // normal: rebias the exponent (127 to 15) and round away the lowest 13 bits of the mantissa
+		return sign | static_cast<std::uint16_t>((bits - 0x38000000u + 0xfffu + ((bits >> 13) & 1u)) >> 13);
+	if (bits < 0x33000000u) // (rounds to) zero
+		return sign;
+	// subnormal
+	const std::uint32_t mantissa{ (bits & 0x7fffffu) | 0x800000u };
+	const unsigned int shift{ 126u - (bits >> 23) };
+	std::uint32_t half{ mantissa >> shift };
+	const std::uint32_t remainder{ mantissa & ((1u << shift) - 1u) };
+	const std::uint32_t halfway{ 1u << (shift - 1u) };
+	if ((remainder > halfway) || ((remainder == halfway) && ((half & 1u) != 0u)))
+		++half;
+	return sign | static_cast<std::uint16_t>(half);
+}
+
+// folds a direction onto the octahedron (x and y, in [-1, 1]). the fourth value (handedness) moves to the third
+void encodeOctahedral(float values[4])
+{
+	const float length{ std::abs(values[0]) + std::abs(values[1]) + std::abs(values[2]) };
+	float x{ 0.f };
+	float y{ 0.f };
+	if (length > 0.f)
+	{
+		x = values[0] / length;
+		y = values[1] / length;
+		if (values[2] < 0.f)
+		{
+			const float foldedX{ (1.f - std::abs(y)) * ((x >= 0.f) ? 1.f : -1.f) };
+			y = (1.f - std::abs(x)) * ((y >= 0.f) ? 1.f : -1.f);
+			x = foldedX;
+		}
+	}
+	values[0] = x;
+	values[1] = y;
+	values[2] = values[3];
+	values[3] = 1.f;
+}
+
+void writeComponent(unsigned char* destination, const Objex::ComponentType componentType, const float value)
+{
+	switch (componentType)
+	{
+	case Objex::ComponentType::NormalizedByte:
+		*reinterpret_cast<signed char*>(destination) = static_cast<signed char>(std::lround(std::min(std::max(value, -1.f), 1.f) * 127.f));
+		break;
+	case Objex::ComponentType::NormalizedUnsignedByte:
+		*destination = static_cast<unsigned char>(std::lround(std::min(std::max(value, 0.f), 1.f) * 255.f));
+		break;
+	case Objex::ComponentType::NormalizedShort:
+	{
+		const std::int16_t component{ static_cast<std::int16_t>(std::lround(std::min(std::max(value, -1.f), 1.f) * 32767.f)) };
+		std::memcpy(destination, &component, sizeof(component));
+		break;
+	}
+	case Objex::ComponentType::NormalizedUnsignedShort:
+	{
+		const std::uint16_t component{ static_cast<std::uint16_t>(std::lround(std::min(std::max(value, 0.f), 1.f) * 65535.f)) };
+		std::memcpy(destination, &component, sizeof(component));
+		break;
+	}
+	case Objex::ComponentType::HalfFloat:
+	{
+		const std::uint16_t component{ toHalfFloat(value) };
+		std::memcpy(destination, &component, sizeof(component));
+		break;
+	}
+	case Objex::ComponentType::Float:
+	default:
+		std::memcpy(destination, &value, sizeof(GLfloat));
+		break;
+	}
+}
+
+// binary cache file: a header followed by each section (in order of CacheSection), each padded to a multiple of 8 bytes
+// sections are stored exactly as they are in memory so can be copied straight into place
+const char cacheMagic[8]{ 'O', 'B', 'J', 'E', 'X', 'B', 'I', 'N' };
+const std::uint32_t cacheVersion{ 5u };
+const std::uint32_t cacheByteOrderMark{ 0x01020304u }; // caches from a machine with different byte order are not used
+
+enum CacheSection
+{
+	Vertices,
+	Normals,
+	Textures,
+	FaceFirstCorners,
+	FaceVertexIndices,
+	FaceNormalIndices,
+	FaceTextureIndices,
+	FaceMaterials,
+	FaceGroups,
+	FaceObjects,
+	VertexArray,
+	NormalArray,
+	TextureArray,
+	ShortIndexArray,
+	IndexArray,
+	IndexedVertexCorners,
+	CommentLineLengths,
+	CommentLineText,
+	UnprocessedLineLengths,
+	UnprocessedLineText,
+	MaterialNameLengths,
+	MaterialNameText,
+	GroupNameLengths,
+	GroupNameText,
+	ObjectNameLengths,
+	ObjectNameText,
+	MaterialLibraryLengths,
+	MaterialLibraryText,
+	NumberOfCacheSections
+};
+
+struct CacheHeader
+{
+	char magic[8];
+	std::uint32_t version;
+	std::uint32_t byteOrderMark;
+	std::uint64_t sourceSize;
+	std::int64_t sourceModificationTime;
+	std::uint64_t sectionSizes[NumberOfCacheSections]; // in bytes (without padding)
+	std::uint32_t isIndexed;
+	std::uint32_t optimizations; // see getOutputOptimizations()
+	std::uint32_t vertexCacheSize;
+	std::uint32_t numberOfParsedLines;
+	std::uint32_t normalGeneration; // see getNormalGeneration()
+	float creaseAngle;
+	std::uint32_t clusterLimits[2]; // maximum vertices and triangles (zero without clusters)
+	Objex::Box localBoundingBox;
+	Objex::VertexCacheStatistics unoptimizedVertexCacheStatistics;
+};
+
+std::size_t getCachePadding(const std::size_t size)
+{
+	return (8u - size % 8u) % 8u;
+}
+
+template <class T>
+void writeCacheSection(std::ofstream& file, const std::vector<T>& section)
+{
+	const char padding[8]{ 0, 0, 0, 0, 0, 0, 0, 0 };
+	file.write(reinterpret_cast<const char*>(section.data()), section.size() * sizeof(T));
+	file.write(padding, getCachePadding(section.size() * sizeof(T)));
+}
+
+// size must already be validated against the size of the cache
+template <class T>
+bool readCacheSection(const char*& cursor, const std::uint64_t size, std::vector<T>& section)
+{
+	if (size % sizeof(T) != 0u)
+		return false;
+	section.resize(static_cast<std::size_t>(size / sizeof(T)));
+	if (size != 0u)
+		std::memcpy(section.data(), cursor, static_cast<std::size_t>(size));
+	cursor += size + getCachePadding(static_cast<std::size_t>(size));
+	return true;
+}
+
+void splitCacheLines(const std::vector<std::string>& lines, std::vector<std::uint32_t>& lengths, std::vector<char>& text)
+{
+	for (const auto& line : lines)
+	{
+		lengths.push_back(static_cast<std::uint32_t>(line.size()));
+		text.insert(text.end(), line.begin(), line.end());
+	}
+}
+
+bool joinCacheLines(const std::vector<std::uint32_t>& lengths, const std::vector<char>& text, std::vector<std::string>& lines)
+{
+	std::size_t position{ 0u };
+	for (const auto& length : lengths)
+	{
+		if (position + length > text.size())
+			return false;
+		lines.emplace_back(text.data() + position, length);
+		position += length;
+	}
+	return true;
+}
+
+// every position is either -1 (none) or in the list
+bool areValidPositions(const std::vector<int>& positions, const std::size_t numberOfNames)
+{
+	return std::all_of(positions.begin(), positions.end(), [&](const int position) { return (position >= -1) && (position < static_cast<int>(numberOfNames)); });
+}
+
+// finds the first index that is not in the list (ignoring -1 (none) if allowed). returns the number of indices if they are all valid
+std::size_t findInvalidIndex(const std::vector<int>& indices, const std::size_t numberOfElements, const bool allowNone)
+{
+	return static_cast<std::size_t>(std::find_if(indices.begin(), indices.end(), [&](const int index) { return (index < (allowNone ? -1 : 0)) || (index >= static_cast<int>(numberOfElements)); }) - indices.begin());
+}
+
+// every index refers to a vertex of the output
+template <class IndexType>
+bool areValidOutputIndices(const std::vector<IndexType>& indices, const std::size_t numberOfVertices)
+{
+	return std::all_of(indices.begin(), indices.end(), [&](const IndexType index) { return index < numberOfVertices; });
+}
+
+bool areValidCorners(const std::vector<unsigned int>& corners, const std::size_t numberOfCorners)
+{
+	return std::all_of(corners.begin(), corners.end(), [&](const unsigned int corner) { return corner < numberOfCorners; });
+}
+
+// transforms consecutive (x, y, z) positions in place by a column-major 4x4 (affine) matrix
+void transformPositionKernel(float* data, const std::size_t numberOfPositions, const float* matrix)
+{
+#ifdef OBJEX_USE_SSE
+	const __m128 column0{ _mm_setr_ps(matrix[0], matrix[1], matrix[2], 0.f) };
+	const __m128 column1{ _mm_setr_ps(matrix[4], matrix[5], matrix[6], 0.f) };
+	const __m128 column2{ _mm_setr_ps(matrix[8], matrix[9], matrix[10], 0.f) };
+	const __m128 column3{ _mm_setr_ps(matrix[12], matrix[13], matrix[14], 0.f) };
+	for (float* position{ data }; position != data + numberOfPositions * 3; position += 3)
+	{
+		const __m128 result{ _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(column0, _mm_set1_ps(position[0])), _mm_mul_ps(column1, _mm_set1_ps(position[1]))), _mm_mul_ps(column2, _mm_set1_ps(position[2]))), column3) };
+		_mm_storel_pi(reinterpret_cast<__m64*>(position), result);
+		_mm_store_ss(position + 2, _mm_movehl_ps(result, result));
+	}
+#else
+	for (float* position{ data }; position != data + numberOfPositions * 3; position += 3)
+	{
+		const float x{ position[0] }, y{ position[1] }, z{ position[2] };
+		position[0] = matrix[0] * x + matrix[4] * y + matrix[8] * z + matrix[12];
+		position[1] = matrix[1] * x + matrix[5] * y + matrix[9] * z + matrix[13];
+		position[2] = matrix[2] * x + matrix[6] * y + matrix[10] * z + matrix[14];
+	}
+#endif // OBJEX_USE_SSE
+}
+
+// transforms consecutive (x, y, z) directions in place by a column-major 3x3 matrix. normalizes the results if requested (zero length directions are left as zero)
+void transformDirectionKernel(float* data, const std::size_t numberOfDirections, const float* matrix, const bool normalize)
+{
+#ifdef OBJEX_USE_SSE
+	const __m128 column0{ _mm_setr_ps(matrix[0], matrix[1], matrix[2], 0.f) };
+	const __m128 column1{ _mm_setr_ps(matrix[3], matrix[4], matrix[5], 0.f) };
+	const __m128 column2{ _mm_setr_ps(matrix[6], matrix[7], matrix[8], 0.f) };
+	for (float* direction{ data }; direction != data + numberOfDirections * 3; direction += 3)
+	{
+		__m128 result{ _mm_add_ps(_mm_add_ps(_mm_mul_ps(column0, _mm_set1_ps(direction[0])), _mm_mul_ps(column1, _mm_set1_ps(direction[1]))), _mm_mul_ps(column2, _mm_set1_ps(direction[2]))) };
+		if (normalize)
+		{
+			const __m128 squared{ _mm_mul_ps(result, result) };
+			const float lengthSquared{ _mm_cvtss_f32(_mm_add_ss(_mm_add_ss(squared, _mm_shuffle_ps(squared, squared, 1)), _mm_movehl_ps(squared, squared))) };
+			if (lengthSquared > 0.f)
+				result = _mm_div_ps(result, _mm_set1_ps(std::sqrt(lengthSquared)));
+		}
+		_mm_storel_pi(reinterpret_cast<__m64*>(direction), result);
+		_mm_store_ss(direction + 2, _mm_movehl_ps(result, result));
+	}
+#else
+	for (float* direction{ data }; direction != data + numberOfDirections * 3; direction += 3)
+	{
+		const float x{ direction[0] }, y{ direction[1] }, z{ direction[2] };
+		direction[0] = matrix[0] * x + matrix[3] * y + matrix[6] * z;
+		direction[1] = matrix[1] * x + matrix[4] * y + matrix[7] * z;
+		direction[2] = matrix[2] * x + matrix[5] * y + matrix[8] * z;
+		if (normalize)
+		{
+			const float lengthSquared{ direction[0] * direction[0] + direction[1] * direction[1] + direction[2] * direction[2] };
+			if (lengthSquared > 0.f)
+			{
+				const float length{ std::sqrt(lengthSquared) };
+				direction[0] /= length;
+				direction[1] /= length;
+				direction[2] /= length;
+			}
+		}
+	}
+#endif // OBJEX_USE_SSE
+}
+
+// minimum and maximum of each coordinate of consecutive (x, y, z) positions. there must be at least one position
+void boundsKernel(const float* data, const std::size_t numberOfPositions, float minimum[3], float maximum[3])
+{
+#ifdef OBJEX_USE_SSE
+	// each load reads four floats (the fourth is the next position's x) so the final position is loaded separately to avoid reading past the end
+	const float* const last{ data + (numberOfPositions - 1) * 3 };
+	__m128 lowest{ _mm_setr_ps(last[0], last[1], last[2], last[0]) };
+	__m128 highest{ lowest };
+	for (const float* position{ data }; position != last; position += 3)
+	{
+		const __m128 value{ _mm_loadu_ps(position) };
+		lowest = _mm_min_ps(lowest, value);
+		highest = _mm_max_ps(highest, value);
+	}
+	float lowestValues[4];
+	float highestValues[4];
+	_mm_storeu_ps(lowestValues, lowest);
+	_mm_storeu_ps(highestValues, highest);
+	std::copy(lowestValues, lowestValues + 3, minimum);
+	std::copy(highestValues, highestValues + 3, maximum);
+#else
+	std::copy(data, data + 3, minimum);
+	std::copy(data, data + 3, maximum);
+	for (const float* position{ data + 3 }; position != data + numberOfPositions * 3; position += 3)
+	{
+		for (unsigned int i{ 0u }; i < 3u; ++i)
+		{
+			minimum[i] = std::min(minimum[i], position[i]);
+			maximum[i] = std::max(maximum[i], position[i]);
+		}
+	}
+#endif // OBJEX_USE_SSE
+}
+
+// draws the triangles with a simulated FIFO post-transform vertex cache. a vertex is in the cache if fewer than cacheSize vertices have been transformed since it was
+template <class Index>
+Objex::VertexCacheStatistics simulateVertexCache(const Index* indices, const std::size_t numberOfIndices, const std::size_t numberOfVertices, const unsigned int cacheSize)
+{
+	Objex::VertexCacheStatistics statistics;
+	if ((numberOfIndices < 3) || (numberOfVertices == 0u))
+		return statistics;
+	std::vector<std::size_t> transformedAt(numberOfVertices, 0u); // number of transformed vertices when each vertex was last transformed (zero is never)
+	std::size_t numberOfTransformedVertices{ 0u };
+	for (const Index* index{ indices }; index != indices + numberOfIndices; ++index)
+	{
+		std::size_t& vertexTransformedAt(transformedAt[*index]);
+		if ((vertexTransformedAt == 0u) || (numberOfTransformedVertices - vertexTransformedAt >= cacheSize))
+			vertexTransformedAt = ++numberOfTransformedVertices;
+	}
+	statistics.acmr = static_cast<float>(numberOfTransformedVertices) / (numberOfIndices / 3);
+	statistics.atvr = static_cast<float>(numberOfTransformedVertices) / numberOfVertices;
+	return statistics;
+}
+
+// reorders triangles so that their vertices are reused from a post-transform vertex cache (Tom Forsyth's "Linear-Speed Vertex Cache Optimisation")
+// localVertices must have an entry of -1 for every vertex and is left that way
+void optimizeVertexCacheOrder(GLuint* indices, const std::size_t numberOfIndices, std::vector<int>& localVertices, const unsigned int cacheSize)
+{
+	const std::size_t numberOfTriangles{ numberOfIndices / 3 };
+	if (numberOfTriangles < 2)
+		return;
+
+	// the triangles' vertices are numbered locally so memory used is proportional to the triangles, not the whole mesh
+	std::vector<GLuint> globalVertices;
+	std::vector<unsigned int> triangleVertices(numberOfIndices);
+	for (std::size_t i{ 0u }; i < numberOfIndices; ++i)
+	{
+		int& localVertex(localVertices[indices[i]]);
+		if (localVertex < 0)
+		{
+			localVertex = static_cast<int>(globalVertices.size());
+			globalVertices.push_back(indices[i]);
+		}
+		triangleVertices[i] = static_cast<unsigned int>(localVertex);
+	}
+	for (const auto& globalVertex : globalVertices)
+		localVertices[globalVertex] = -1;
+	const std::size_t numberOfVertices{ globalVertices.size() };
+
+	// triangles of each vertex (CSR). the first "remaining" of each vertex's triangles have not been output yet
+	std::vector<unsigned int> firstTriangles(numberOfVertices + 1, 0u);
+	for (const auto& vertex : triangleVertices)
+		++firstTriangles[vertex + 1];
+	for (std::size_t vertex{ 0u }; vertex < numberOfVertices; ++vertex)
+		firstTriangles[vertex + 1] += firstTriangles[vertex];
+	std::vector<unsigned int> vertexTriangles(numberOfIndices);
+	std::vector<unsigned int> remainingTriangles(numberOfVertices, 0u);
+	for (std::size_t i{ 0u }; i < numberOfIndices; ++i)
+	{
+		const unsigned int vertex{ triangleVertices[i] };
+		vertexTriangles[firstTriangles[vertex] + remainingTriangles[vertex]++] = static_cast<unsigned int>(i / 3);
+	}
+
+	// vertices score higher the more recently they were used and the fewer triangles they have left. a triangle's score is the sum of its vertices' scores
+	const unsigned int scoredCacheSize{ std::max(cacheSize, 4u) };
+	auto getVertexScore = [&](const int cachePosition, const unsigned int numberOfRemainingTriangles)
+	{
+		if (numberOfRemainingTriangles == 0u)
+			return -1.f;
+		float score{ 0.f };
+		if (cachePosition >= 0)
+			score = (cachePosition < 3) ? 0.75f : std::pow(1.f - static_cast<float>(cachePosition - 3) / (scoredCacheSize - 3), 1.5f); // the last triangle's vertices have a fixed score so no edge of it is favoured
+		return score + 2.f / std::sqrt(static_cast<float>(numberOfRemainingTriangles));
+	};
+	std::vector<int> cachePositions(numberOfVertices, -1);
+	std::vector<float> vertexScores(numberOfVertices);
+	for (std::size_t vertex{ 0u }; vertex < numberOfVertices; ++vertex)
+		vertexScores[vertex] = getVertexScore(-1, remainingTriangles[vertex]);
+	auto getTriangleScore = [&](const std::size_t triangle)
+	{
+		return vertexScores[triangleVertices[triangle * 3]] + vertexScores[triangleVertices[triangle * 3 + 1]] + vertexScores[triangleVertices[triangle * 3 + 2]];
+	};
+	long long bestTriangle{ 0 };
+	for (std::size_t triangle{ 1u }; triangle < numberOfTriangles; ++triangle)
+	{
+		if (getTriangleScore(triangle) > getTriangleScore(static_cast<std::size_t>(bestTriangle)))
+			bestTriangle = static_cast<long long>(triangle);
+	}
+
+	std::vector<char> isTriangleOutput(numberOfTriangles, 0);
+	std::size_t nextTriangle{ 0u }; // where to look for a triangle when none of the cached vertices have any left
+	std::vector<unsigned int> cache;
+	std::vector<unsigned int> newCache;
+	std::vector<GLuint> output;
+	output.reserve(numberOfIndices);
+	while (output.size() < numberOfIndices)
+	{
+		if (bestTriangle < 0)
+		{
+			while (isTriangleOutput[nextTriangle] != 0)
+				++nextTriangle;
+			bestTriangle = static_cast<long long>(nextTriangle);
+		}
+		const std::size_t triangle{ static_cast<std::size_t>(bestTriangle) };
+		isTriangleOutput[triangle] = 1;
+
+		// the triangle's vertices move to the front of the (least recently used) cache and the triangle is removed from their remaining triangles
+		newCache.clear();
+		for (std::size_t corner{ triangle * 3 }; corner < triangle * 3 + 3; ++corner)
+		{
+			const unsigned int vertex{ triangleVertices[corner] };
+			output.push_back(globalVertices[vertex]);
+			unsigned int* const triangles{ vertexTriangles.data() + firstTriangles[vertex] };
+			unsigned int& numberOfRemainingTriangles(remainingTriangles[vertex]);
+			std::swap(*std::find(triangles, triangles + numberOfRemainingTriangles, static_cast<unsigned int>(triangle)), triangles[numberOfRemainingTriangles - 1]);
+			--numberOfRemainingTriangles;
+			if (std::find(newCache.begin(), newCache.end(), vertex) == newCache.end())
+				newCache.push_back(vertex);
+		}
+		const std::size_t numberOfTriangleVertices{ newCache.size() }; // less than three if the triangle is degenerate
+		for (const auto& vertex : cache)
+		{
+			if (std::find(newCache.begin(), newCache.begin() + numberOfTriangleVertices, vertex) == newCache.begin() + numberOfTriangleVertices)
+				newCache.push_back(vertex);
+		}
+		for (std::size_t position{ 0u }; position < newCache.size(); ++position)
+		{
+			const unsigned int vertex{ newCache[position] };
+			cachePositions[vertex] = (position < scoredCacheSize) ? static_cast<int>(position) : -1;
+			vertexScores[vertex] = getVertexScore(cachePositions[vertex], remainingTriangles[vertex]);
+		}
+
+		// only triangles of cached vertices have changed score so the next triangle is the best of those (if there are any)
+		bestTriangle = -1;
+		float bestScore{ 0.f };
+		for (const auto& vertex : newCache)
+		{
+			for (unsigned int i{ firstTriangles[vertex] }; i < firstTriangles[vertex] + remainingTriangles[vertex]; ++i)
+			{
+				const float score{ getTriangleScore(vertexTriangles[i]) };
+				if (score > bestScore)
+				{
+					bestScore = score;
+					bestTriangle = static_cast<long long>(vertexTriangles[i]);
+				}
+			}
+		}
+		if (newCache.size() > scoredCacheSize)
+			newCache.resize(scoredCacheSize);
+		cache.swap(newCache);
+	}
+	std::copy(output.begin(), output.end(), indices);
+}
+
+// orders clusters of triangles so that those facing outwards from the centre are drawn first (from Sander, Nehab and Barczak's "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw")
+// a cluster starts at each triangle with no vertices in the simulated cache so reordering them barely affects the cache. transformedAt must be zero for every vertex and is left that way
+void optimizeOverdrawOrder(GLuint* indices, const std::size_t numberOfIndices, const std::vector<GLfloat>& positions, std::vector<std::size_t>& transformedAt, const unsigned int cacheSize)
+{
+	const std::size_t numberOfTriangles{ numberOfIndices / 3 };
+	std::vector<std::size_t> clusterFirstTriangles;
+	std::size_t numberOfTransformedVertices{ 0u };
+	for (std::size_t triangle{ 0u }; triangle < numberOfTriangles; ++triangle)
+	{
+		unsigned int numberOfMisses{ 0u };
+		for (std::size_t corner{ triangle * 3 }; corner < triangle * 3 + 3; ++corner)
+		{
+			std::size_t& vertexTransformedAt(transformedAt[indices[corner]]);
+			if ((vertexTransformedAt == 0u) || (numberOfTransformedVertices - vertexTransformedAt >= cacheSize))
+			{
+				vertexTransformedAt = ++numberOfTransformedVertices;
+				++numberOfMisses;
+			}
+		}
+		if ((numberOfMisses == 3u) || (triangle == 0u))
+			clusterFirstTriangles.push_back(triangle);
+	}
+	for (std::size_t i{ 0u }; i < numberOfIndices; ++i)
+		transformedAt[indices[i]] = 0u;
+	clusterFirstTriangles.push_back(numberOfTriangles);
+	const std::size_t numberOfClusters{ clusterFirstTriangles.size() - 1 };
+	if (numberOfClusters < 2)
+		return;
+
+	// area-weighted centre and normal of each cluster (and the centre of them all)
+	std::vector<Objex::Vertex> clusterCenters(numberOfClusters, Objex::Vertex{ 0.f, 0.f, 0.f });
+	std::vector<Objex::Vertex> clusterNormals(numberOfClusters, Objex::Vertex{ 0.f, 0.f, 0.f });
+	Objex::Vertex center{ 0.f, 0.f, 0.f };
+	float totalArea{ 0.f };
+	for (std::size_t cluster{ 0u }; cluster < numberOfClusters; ++cluster)
+	{
+		float clusterArea{ 0.f };
+		for (std::size_t triangle{ clusterFirstTriangles[cluster] }; triangle < clusterFirstTriangles[cluster + 1]; ++triangle)
+		{
+			const GLfloat* const a{ positions.data() + indices[triangle * 3] * 3 };
+			const GLfloat* const b{ positions.data() + indices[triangle * 3 + 1] * 3 };
+			const GLfloat* const c{ positions.data() + indices[triangle * 3 + 2] * 3 };
+			const Objex::Vertex ab{ b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+			const Objex::Vertex ac{ c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+			const Objex::Vertex normal{ ab.y * ac.z - ab.z * ac.y, ab.z * ac.x - ab.x * ac.z, ab.x * ac.y - ab.y * ac.x }; // length is twice the area
+			const float area{ std::sqrt(normal.x * normal.x + normal.y * normal.y + normal.z * normal.z) / 2.f };
+			clusterCenters[cluster].x += (a[0] + b[0] + c[0]) / 3.f * area;
+			clusterCenters[cluster].y += (a[1] + b[1] + c[1]) / 3.f * area;
+			clusterCenters[cluster].z += (a[2] + b[2] + c[2]) / 3.f * area;
+			clusterNormals[cluster].x += normal.x;
+			clusterNormals[cluster].y += normal.y;
+			clusterNormals[cluster].z += normal.z;
+			clusterArea += area;
+		}
+		center.x += clusterCenters[cluster].x;
+		center.y += clusterCenters[cluster].y;
+		center.z += clusterCenters[cluster].z;
+		totalArea += clusterArea;
+		if (clusterArea > 0.f)
+		{
+			clusterCenters[cluster].x /= clusterArea;
+			clusterCenters[cluster].y /= clusterArea;
+			clusterCenters[cluster].z /= clusterArea;
+		}
+	}
+	if (totalArea <= 0.f)
+		return;
+	center.x /= totalArea;
+	center.y /= totalArea;
+	center.z /= totalArea;
+
+	// clusters that face further away from the centre are drawn first
+	std::vector<float> sortKeys(numberOfClusters, 0.f);
+	for (std::size_t cluster{ 0u }; cluster < numberOfClusters; ++cluster)
+	{
+		const Objex::Vertex& normal(clusterNormals[cluster]);
+		const float length{ std::sqrt(normal.x * normal.x + normal.y * normal.y + normal.z * normal.z) };
+		if (length > 0.f)
+			sortKeys[cluster] = ((clusterCenters[cluster].x - center.x) * normal.x + (clusterCenters[cluster].y - center.y) * normal.y + (clusterCenters[cluster].z - center.z) * normal.z) / length;
+	}
+	std::vector<std::size_t> clusterOrder(numberOfClusters);
+	for (std::size_t cluster{ 0u }; cluster < numberOfClusters; ++cluster)
+		clusterOrder[cluster] = cluster;
+	std::stable_sort(clusterOrder.begin(), clusterOrder.end(), [&](const std::size_t a, const std::size_t b) { return sortKeys[a] > sortKeys[b]; });
+	std::vector<GLuint> output;
+	output.reserve(numberOfIndices);
+	for (const auto& cluster : clusterOrder)
+		output.insert(output.end(), indices + clusterFirstTriangles[cluster] * 3, indices + clusterFirstTriangles[cluster + 1] * 3);
+	std::copy(output.begin(), output.end(), indices);
+}
+
+// sum of (weighted) squared distances to planes: p.A.p + 2b.p + c (A is symmetric so only six of its elements are stored)
+struct Quadric
+{
+	double a00{ 0.0 }, a01{ 0.0 }, a02{ 0.0 }, a11{ 0.0 }, a12{ 0.0 }, a22{ 0.0 };
+	double b0{ 0.0 }, b1{ 0.0 }, b2{ 0.0 };
+	double c{ 0.0 };
+	double weight{ 0.0 };
+
+	// normal must be normalized. plane is normal.p + d = 0
+	void addPlane(const double x, const double y, const double z, const double d, const double planeWeight)
+	{
+		a00 += planeWeight * x * x;
+		a01 += planeWeight * x * y;
+		a02 += planeWeight * x * z;
+		a11 += planeWeight * y * y;
+		a12 += planeWeight * y * z;
+		a22 += planeWeight * z * z;
+		b0 += planeWeight * x * d;
+		b1 += planeWeight * y * d;
+		b2 += planeWeight * z * d;
+		c += planeWeight * d * d;
+		weight += planeWeight;
+	}
+
+	void add(const Quadric& other)
+	{
+		a00 += other.a00;
+		a01 += other.a01;
+		a02 += other.a02;
+		a11 += other.a11;
+		a12 += other.a12;
+		a22 += other.a22;
+		b0 += other.b0;
+		b1 += other.b1;
+		b2 += other.b2;
+		c += other.c;
+		weight += other.weight;
+	}
+
+	double evaluate(const double x, const double y, const double z) const
+	{
+		const double result{ x * (a00 * x + 2.0 * (a01 * y + a02 * z + b0)) + y * (a11 * y + 2.0 * (a12 * z + b1)) + z * (a22 * z + 2.0 * b2) + c };
+		return std::max(result, 0.0);
+	}
+};
+
+// simplifies indexed triangles by collapsing vertices into neighbouring vertices (half-edge collapses) in order of least quadric error
+// triangle corners are "wedges" (output vertices). wedges with the same position index are one vertex of the surface and each triangle has a material
+// only vertices with a single wedge, a single material and no open edges are removed so seams, material boundaries and borders are kept exactly
+class MeshSimplifier
+{
+public:
+	MeshSimplifier(const GLfloat* wedgePositions, const std::vector<unsigned int>& wedgeVertices, const std::size_t numberOfVertices, std::vector<GLuint> indices, std::vector<int> triangleMaterials)
+		: mWedgePositions(wedgePositions)
+		, mWedgeVertices(wedgeVertices)
+		, mIndices(std::move(indices))
+		, mTriangleMaterials(std::move(triangleMaterials))
+		, mIsTriangleRemoved(mIndices.size() / 3, 0)
+		, mNumberOfTriangles(mIndices.size() / 3)
+		, mVertexTriangles(numberOfVertices)
+		, mVertexWedges(numberOfVertices, noWedge)
+		, mIsVertexLocked(numberOfVertices, 0)
+		, mIsVertexRemoved(numberOfVertices, 0)
+		, mVersions(numberOfVertices, 0u)
+		, mQuadrics(numberOfVertices)
+	{
+		// lock vertices with more than one wedge or material
+		std::vector<int> vertexMaterials(numberOfVertices, 0);
+		for (std::size_t triangle{ 0u }; triangle < mNumberOfTriangles; ++triangle)
+		{
+			for (std::size_t corner{ triangle * 3 }; corner < triangle * 3 + 3; ++corner)
+			{
+				const GLuint wedge{ mIndices[corner] };
+				const unsigned int vertex{ mWedgeVertices[wedge] };
+				if ((mVertexWedges[vertex] != noWedge) && ((mVertexWedges[vertex] != wedge) || (vertexMaterials[vertex] != mTriangleMaterials[triangle])))
+					mIsVertexLocked[vertex] = 1;
+				mVertexWedges[vertex] = wedge;
+				vertexMaterials[vertex] = mTriangleMaterials[triangle];
+				mVertexTriangles[vertex].push_back(static_cast<unsigned int>(triangle));
+			}
+		}
+
+		// lock vertices of edges that are not shared by exactly two triangles (open borders and non-manifold edges) and of degenerate triangles
+		std::vector<unsigned long long> edges;
+		edges.reserve(mIndices.size());
+		for (std::size_t triangle{ 0u }; triangle < mNumberOfTriangles; ++triangle)
+		{
+			for (unsigned int edge{ 0u }; edge < 3u; ++edge)
+			{
+				const unsigned int a{ getVertex(triangle, edge) };
+				const unsigned int b{ getVertex(triangle, (edge + 1) % 3) };
+				if (a == b)
+					mIsVertexLocked[a] = 1;
+				edges.push_back((static_cast<unsigned long long>(std::min(a, b)) << 32) | std::max(a, b));
+			}
+		}
+		std::sort(edges.begin(), edges.end());
+		for (auto edge{ edges.begin() }; edge != edges.end();)
+		{
+			const auto nextEdge{ std::upper_bound(edge, edges.end(), *edge) };
+			if (nextEdge - edge != 2)
+			{
+				mIsVertexLocked[static_cast<unsigned int>(*edge >> 32)] = 1;
+				mIsVertexLocked[static_cast<unsigned int>(*edge)] = 1;
+			}
+			edge = nextEdge;
+		}
+
+		// each vertex's quadric is the planes of its triangles, weighted by area
+		for (std::size_t triangle{ 0u }; triangle < mNumberOfTriangles; ++triangle)
+		{
+			const GLfloat* const a{ getPosition(getVertex(triangle, 0)) };
+			const GLfloat* const b{ getPosition(getVertex(triangle, 1)) };
+			const GLfloat* const c{ getPosition(getVertex(triangle, 2)) };
+			double normal[3];
+			getNormal(a, b, c, normal);
+			const double length{ std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]) };
+			if (length == 0.0)
+				continue;
+			Quadric quadric;
+			quadric.addPlane(normal[0] / length, normal[1] / length, normal[2] / length, -(normal[0] * a[0] + normal[1] * a[1] + normal[2] * a[2]) / length, length / 2.0);
+			for (unsigned int corner{ 0u }; corner < 3u; ++corner)
+				mQuadrics[getVertex(triangle, corner)].add(quadric);
+		}
+
+		for (unsigned int vertex{ 0u }; vertex < numberOfVertices; ++vertex)
+			queueCollapse(vertex);
+	}
+
+	// collapses until there are no more than targetNumberOfTriangles or the next collapse would exceed maximumError. returns the largest error so far
+	float simplify(const std::size_t targetNumberOfTriangles, const float maximumError)
+	{
+		const double maximumCost{ static_cast<double>(maximumError) * maximumError };
+		while ((mNumberOfTriangles > targetNumberOfTriangles) && !mCollapses.empty())
+		{
+			const Collapse collapse{ mCollapses.top() };
+			if (collapse.cost > maximumCost)
+				break;
+			mCollapses.pop();
+			if ((mIsVertexRemoved[collapse.from] != 0) || (collapse.version != mVersions[collapse.from]))
+				continue; // outdated
+			collapseVertex(collapse.from, collapse.to);
+			mMaximumCost = std::max(mMaximumCost, collapse.cost);
+		}
+		return static_cast<float>(std::sqrt(mMaximumCost));
+	}
+
+	// remaining triangles in their original order
+	void getTriangles(std::vector<GLuint>& indices, std::vector<int>& triangleMaterials) const
+	{
+		indices.clear();
+		triangleMaterials.clear();
+		for (std::size_t triangle{ 0u }; triangle < mIsTriangleRemoved.size(); ++triangle)
+		{
+			if (mIsTriangleRemoved[triangle] != 0)
+				continue;
+			indices.insert(indices.end(), mIndices.begin() + triangle * 3, mIndices.begin() + triangle * 3 + 3);
+			triangleMaterials.push_back(mTriangleMaterials[triangle]);
+		}
+	}
+
+private:
+	static const GLuint noWedge{ std::numeric_limits<GLuint>::max() };
+
+	struct Collapse
+	{
+		double cost;
+		unsigned int from;
+		unsigned int to;
+		unsigned int version; // of "from" when this was queued. collapses of vertices that have changed since are ignored
+		bool operator<(const Collapse& other) const
+		{
+			return cost > other.cost; // lowest cost first
+		}
+	};
+
+	const GLfloat* mWedgePositions;
+	const std::vector<unsigned int>& mWedgeVertices;
+	std::vector<GLuint> mIndices;
+	std::vector<int> mTriangleMaterials;
+	std::vector<char> mIsTriangleRemoved;
+	std::size_t mNumberOfTriangles;
+	std::vector<std::vector<unsigned int>> mVertexTriangles; // remaining triangles that use each vertex
+	std::vector<GLuint> mVertexWedges; // a wedge of each vertex (the only one if the vertex is not locked)
+	std::vector<char> mIsVertexLocked;
+	std::vector<char> mIsVertexRemoved;
+	std::vector<unsigned int> mVersions;
+	std::vector<Quadric> mQuadrics;
+	std::priority_queue<Collapse> mCollapses;
+	double mMaximumCost{ 0.0 };
+	// reused between collapses
+	std::vector<unsigned int> mNeighbours;
+	std::vector<unsigned int> mOtherNeighbours;
+	std::vector<std::pair<double, unsigned int>> mCandidates;
+
+	static void getNormal(const GLfloat* a, const GLfloat* b, const GLfloat* c, double normal[3])
+	{
+		const double ab[3]{ static_cast<double>(b[0]) - a[0], static_cast<double>(b[1]) - a[1], static_cast<double>(b[2]) - a[2] };
+		const double ac[3]{ static_cast<double>(c[0]) - a[0], static_cast<double>(c[1]) - a[1], static_cast<double>(c[2]) - a[2] };
+		normal[0] = ab[1] * ac[2] - ab[2] * ac[1];
+		normal[1] = ab[2] * ac[0] - ab[0] * ac[2];
+		normal[2] = ab[0] * ac[1] - ab[1] * ac[0];
+	}
+
+	unsigned int getVertex(const std::size_t triangle, const unsigned int corner) const
+	{
+		return mWedgeVertices[mIndices[triangle * 3 + corner]];
+	}
+
+	const GLfloat* getPosition(const unsigned int vertex) const
+	{
+		return mWedgePositions + static_cast<std::size_t>(mVertexWedges[vertex]) * 3;
+	}
+
+	void getNeighbours(const unsigned int vertex, std::vector<unsigned int>& neighbours) const
+	{
+		neighbours.clear();
+		for (const auto& triangle : mVertexTriangles[vertex])
+		{
+			for (unsigned int corner{ 0u }; corner < 3u; ++corner)
+			{
+				if (getVertex(triangle, corner) != vertex)
+					neighbours.push_back(getVertex(triangle, corner));
+			}
+		}
+		std::sort(neighbours.begin(), neighbours.end());
+		neighbours.erase(std::unique(neighbours.begin(), neighbours.end()), neighbours.end());
+	}
+
+	// from's triangles must not flip (or become degenerate), the surface must stay manifold (the vertices share exactly two neighbours)
+	// and the triangles on the collapsed edge must use the same wedge of "to" (otherwise the collapse would cross a seam at "to")
+	bool isCollapseValid(const unsigned int from, const unsigned int to, const std::vector<unsigned int>& fromNeighbours)
+	{
+		getNeighbours(to, mOtherNeighbours);
+		unsigned int numberOfSharedNeighbours{ 0u };
+		for (std::size_t fromNeighbour{ 0u }, toNeighbour{ 0u }; (fromNeighbour < fromNeighbours.size()) && (toNeighbour < mOtherNeighbours.size());)
+		{
+			if (fromNeighbours[fromNeighbour] < mOtherNeighbours[toNeighbour])
+				++fromNeighbour;
+			else if (mOtherNeighbours[toNeighbour] < fromNeighbours[fromNeighbour])
+				++toNeighbour;
+			else
+			{
+				++numberOfSharedNeighbours;
+				++fromNeighbour;
+				++toNeighbour;
+			}
+		}
+		if (numberOfSharedNeighbours != 2u)
+			return false;
+
+		GLuint toWedge{ noWedge };
+		for (const auto& triangle : mVertexTriangles[from])
+		{
+			unsigned int fromCorner{ 0u };
+			int toCorner{ -1 };
+			for (unsigned int corner{ 0u }; corner < 3u; ++corner)
+			{
+				if (getVertex(triangle, corner) == from)
+					fromCorner = corner;
+				else if (getVertex(triangle, corner) == to)
+					toCorner = static_cast<int>(corner);
+			}
+			if (toCorner >= 0)
+			{
+				const GLuint wedge{ mIndices[triangle * 3 + toCorner] };
+				if ((toWedge != noWedge) && (wedge != toWedge))
+					return false;
+				toWedge = wedge;
+				continue;
+			}
+			const GLfloat* positions[3]{ getPosition(getVertex(triangle, 0)), getPosition(getVertex(triangle, 1)), getPosition(getVertex(triangle, 2)) };
+			double before[3];
+			getNormal(positions[0], positions[1], positions[2], before);
+			positions[fromCorner] = getPosition(to);
+			double after[3];
+			getNormal(positions[0], positions[1], positions[2], after);
+			if (before[0] * after[0] + before[1] * after[1] + before[2] * after[2] <= 0.0)
+				return false;
+		}
+		return true;
+	}
+
+	// queues the cheapest valid collapse of the vertex (if it can be removed)
+	void queueCollapse(const unsigned int vertex)
+	{
+		++mVersions[vertex];
+		if ((mIsVertexLocked[vertex] != 0) || (mIsVertexRemoved[vertex] != 0) || mVertexTriangles[vertex].empty())
+			return;
+		getNeighbours(vertex, mNeighbours);
+		mCandidates.clear();
+		for (const auto& neighbour : mNeighbours)
+		{
+			Quadric quadric(mQuadrics[vertex]);
+			quadric.add(mQuadrics[neighbour]);
+			const GLfloat* const position{ getPosition(neighbour) };
+			mCandidates.emplace_back((quadric.weight > 0.0) ? quadric.evaluate(position[0], position[1], position[2]) / quadric.weight : 0.0, neighbour); // mean squared distance
+		}
+		// validation is the expensive part so only the cheapest valid collapse is found
+		std::sort(mCandidates.begin(), mCandidates.end());
+		for (const auto& candidate : mCandidates)
+		{
+			if (isCollapseValid(vertex, candidate.second, mNeighbours))
+			{
+				mCollapses.push({ candidate.first, vertex, candidate.second, mVersions[vertex] });
+				return;
+			}
+		}
+	}
+
+	void collapseVertex(const unsigned int from, const unsigned int to)
+	{
+		// triangles on the collapsed edge are removed and the rest of from's triangles use "to" instead
+		GLuint toWedge{ noWedge };
+		for (const auto& triangle : mVertexTriangles[from])
+		{
+			for (unsigned int corner{ 0u }; corner < 3u; ++corner)
+			{
+				if (getVertex(triangle, corner) == to)
+					toWedge = mIndices[triangle * 3 + corner];
+			}
+		}
+		for (const auto& triangle : mVertexTriangles[from])
+		{
+			bool isOnEdge{ false };
+			for (unsigned int corner{ 0u }; corner < 3u; ++corner)
+				isOnEdge = isOnEdge || (getVertex(triangle, corner) == to);
+			if (isOnEdge)
+			{
+				mIsTriangleRemoved[triangle] = 1;
+				--mNumberOfTriangles;
+				for (unsigned int corner{ 0u }; corner < 3u; ++corner)
+				{
+					const unsigned int vertex{ getVertex(triangle, corner) };
+					if (vertex != from)
+					{
+						std::vector<unsigned int>& triangles(mVertexTriangles[vertex]);
+						triangles.erase(std::find(triangles.begin(), triangles.end(), triangle));
+					}
+				}
+			}
+			else
+			{
+				for (unsigned int corner{ 0u }; corner < 3u; ++corner)
+				{
+					if (getVertex(triangle, corner) == from)
+						mIndices[triangle * 3 + corner] = toWedge;
+				}
+				mVertexTriangles[to].push_back(triangle);
+			}
+		}
+		mVertexTriangles[from].clear();
+		mIsVertexRemoved[from] = 1;
+		mQuadrics[to].add(mQuadrics[from]);
+
+		// collapses of "to" and its neighbours (which include from's neighbours) have changed
+		std::vector<unsigned int> neighbours;
+		getNeighbours(to, neighbours);
+		queueCollapse(to);
+		for (const auto& neighbour : neighbours)
+			queueCollapse(neighbour);
+	}
+};
+
+const GLuint MeshSimplifier::noWedge;
+
+// output options that change the contents of indexed output (stored in the cache to know whether its output can be used)
+std::uint32_t getOutputOptimizations(const Objex::OutputOptions& options)
+{
+	if (!options.indexed)
+		return 0u;
+	return (options.optimizeVertexCache ? 1u : 0u) | (options.optimizeOverdraw ? 2u : 0u) | (options.optimizeVertexFetch ? 4u : 0u);
+}
+
+// how normals are generated when loading (stored in the cache to know whether its normals can be used)
+std::uint32_t getNormalGeneration(const Objex::LoadOptions& options)
+{
+	if (!options.generateMissingNormals)
+		return 0u;
+	return 1u | (options.normalOptions.smooth ? 2u : 0u) | (options.normalOptions.weightByAngle ? 4u : 0u) | (options.normalOptions.weightByArea ? 8u : 0u);
+}
+
+// absolute path without links or "." and ".." (the filename itself if it cannot be found)
+std::string getCanonicalPath(const std::string& filename)
+{
+#ifdef _WIN32
+	char path[_MAX_PATH];
+	if (_fullpath(path, filename.c_str(), _MAX_PATH) != nullptr)
+		return path;
+#else
+	char* const path{ realpath(filename.c_str(), nullptr) };
+	if (path != nullptr)
+	{
+		const std::string canonicalPath(path);
+		std::free(path);
+		return canonicalPath;
+	}
+#endif // _WIN32
+	return filename;
+}
+
+// identifies a mesh in a registry: the file (as it is now) and the options that change the result (but not e.g. the number of threads or the file access). empty if the file does not exist
+std::string getRegistryKey(const std::string& filename, const Objex::LoadOptions& loadOptions, const Objex::OutputOptions& outputOptions)
+{
+	struct stat filestatus;
+	if (stat(filename.c_str(), &filestatus) != 0)
+		return std::string();
+	std::ostringstream key;
+	key.precision(9);
+	key << getCanonicalPath(filename) << '\n' << static_cast<unsigned long long>(filestatus.st_size) << ' ' << static_cast<long long>(filestatus.st_mtime) << ' ' <<
+		getNormalGeneration(loadOptions) << ' ' << (loadOptions.generateMissingNormals ? loadOptions.normalOptions.creaseAngle : 0.f) << ' ' << loadOptions.keepSourceData << ' ' <<
+		outputOptions.indexed << ' ' << getOutputOptimizations(outputOptions) << ' ' << outputOptions.vertexCacheSize << ' ' << outputOptions.tangents << ' ' << outputOptions.interleavedStrideAlignment << ' ' <<
+		(outputOptions.clusters ? outputOptions.maximumClusterVertices : 0u) << ' ' << (outputOptions.clusters ? outputOptions.maximumClusterTriangles : 0u);
+	for (const auto& format : outputOptions.interleavedLayout)
+		key << ' ' << static_cast<int>(format.attribute) << ',' << format.numberOfComponents << ',' << static_cast<int>(format.componentType) << ',' << static_cast<int>(format.encoding);
+	return key.str();
+}
+
+// corners that use each vertex (CSR: corners of vertex i are [first[i], first[i + 1]) of corners, in increasing order). corners without a valid vertex are left out
+void buildVertexCorners(const std::vector<int>& faceVertexIndices, const std::size_t numberOfVertices, std::vector<unsigned int>& first, std::vector<unsigned int>& corners)
+{
+	first.assign(numberOfVertices + 1, 0u);
+	for (const auto& vertex : faceVertexIndices)
+	{
+		if ((vertex >= 0) && (static_cast<std::size_t>(vertex) < numberOfVertices))
+			++first[vertex + 1];
+	}
+	for (std::size_t vertex{ 0u }; vertex < numberOfVertices; ++vertex)
+		first[vertex + 1] += first[vertex];
+	corners.resize(first.back());
+	std::vector<unsigned int> next(first.begin(), first.end() - 1);
+	for (std::size_t corner{ 0u }; corner < faceVertexIndices.size(); ++corner)
+	{
+		const int vertex{ faceVertexIndices[corner] };
+		if ((vertex >= 0) && (static_cast<std::size_t>(vertex) < numberOfVertices))
+			corners[next[vertex]++] = static_cast<unsigned int>(corner);
+	}
+}
+
+inline void subtract(const Objex::Vertex& a, const Objex::Vertex& b, float result[3])
+{
+	result[0] = a.x - b.x;
+	result[1] = a.y - b.y;
+	result[2] = a.z - b.z;
+}
+
+inline float dot(const float a[3], const float b[3])
+{
+	return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+inline void cross(const float a[3], const float b[3], float result[3])
+{
+	result[0] = a[1] * b[2] - a[2] * b[1];
+	result[1] = a[2] * b[0] - a[0] * b[2];
+	result[2] = a[0] * b[1] - a[1] * b[0];
+}
+
+// returns false (and leaves the vector unchanged) if it has no length
+inline bool normalize(float vector[3])
+{
+	const float length{ std::sqrt(dot(vector, vector)) };
+	if (!(length > 0.f))
+		return false;
+	vector[0] /= length;
+	vector[1] /= length;
+	vector[2] /= length;
+	return true;
+}
+
+// angle between the directions from a corner to its two neighbours
+inline float getCornerAngle(const Objex::Vertex& corner, const Objex::Vertex& previous, const Objex::Vertex& next)
+{
+	float toPrevious[3];
+	float toNext[3];
+	subtract(previous, corner, toPrevious);
+	subtract(next, corner, toNext);
+	if (!normalize(toPrevious) || !normalize(toNext))
+		return 0.f;
+	return std::acos(std::max(-1.f, std::min(dot(toPrevious, toNext), 1.f)));
+}
+
+const unsigned int numberOfBvhBins{ 16u }; // planes considered (on each axis) when splitting a bvh node
+
+// surface area of a box (relative cost of a ray hitting it)
+inline float getBoxArea(const float minimum[3], const float maximum[3])
+{
+	const float size[3]{ maximum[0] - minimum[0], maximum[1] - minimum[1], maximum[2] - minimum[2] };
+	return size[0] * size[1] + size[1] * size[2] + size[2] * size[0];
+}
+
+inline void includeInBounds(const float pointMinimum[3], const float pointMaximum[3], float minimum[3], float maximum[3])
+{
+	for (unsigned int axis{ 0u }; axis < 3u; ++axis)
+	{
+		minimum[axis] = std::min(minimum[axis], pointMinimum[axis]);
+		maximum[axis] = std::max(maximum[axis], pointMaximum[axis]);
+	}
+}
+
+// distance along the ray where it enters the box (infinity if it misses)
+inline float getRayBoxDistance(const float origin[3], const float inverseDirection[3], const float minimum[3], const float maximum[3], const float maximumDistance)
+{
+	float entry{ 0.f };
+	float exit{ maximumDistance };
+	for (unsigned int axis{ 0u }; axis < 3u; ++axis)
+	{
+		const float near{ (minimum[axis] - origin[axis]) * inverseDirection[axis] };
+		const float far{ (maximum[axis] - origin[axis]) * inverseDirection[axis] };
+		entry = std::max(entry, std::min(near, far));
+		exit = std::min(exit, std::max(near, far));
+	}
+	return (entry <= exit) ? entry : std::numeric_limits<float>::infinity();
+}
+
+// Moller-Trumbore (from either side). distance is only set on a hit
+inline bool intersectRayTriangle(const float origin[3], const float direction[3], const Objex::Vertex& a, const Objex::Vertex& b, const Objex::Vertex& c, const float maximumDistance, float& distance)
+{
+	float edge1[3];
+	float edge2[3];
+	subtract(b, a, edge1);
+	subtract(c, a, edge2);
+	float p[3];
+	cross(direction, edge2, p);
+	const float determinant{ dot(edge1, p) };
+	if (determinant == 0.f)
+		return false;
+	const float inverseDeterminant{ 1.f / determinant };
+	const float toOrigin[3]{ origin[0] - a.x, origin[1] - a.y, origin[2] - a.z };
+	const float u{ dot(toOrigin, p) * inverseDeterminant };
+	if ((u < 0.f) || (u > 1.f))
+		return false;
+	float q[3];
+	cross(toOrigin, edge1, q);
+	const float v{ dot(direction, q) * inverseDeterminant };
+	if ((v < 0.f) || (u + v > 1.f))
+		return false;
+	const float t{ dot(edge2, q) * inverseDeterminant };
+	if ((t < 0.f) || (t > maximumDistance))
+		return false;
+	distance = t;
+	return true;
+}
+
+// closest point on a triangle (by the region of the point, as in "Real-Time Collision Detection")
+void getClosestPointOnTriangle(const float point[3], const Objex::Vertex& a, const Objex::Vertex& b, const Objex::Vertex& c, float result[3])
+{
+	const float vertices[3][3]{ { a.x, a.y, a.z }, { b.x, b.y, b.z }, { c.x, c.y, c.z } };
+	auto combine = [&](const float weightB, const float weightC)
+	{
+		for (unsigned int axis{ 0u }; axis < 3u; ++axis)
+			result[axis] = vertices[0][axis] + weightB * (vertices[1][axis] - vertices[0][axis]) + weightC * (vertices[2][axis] - vertices[0][axis]);
+	};
+	float ab[3];
+	float ac[3];
+	float ap[3];
+	for (unsigned int axis{ 0u }; axis < 3u; ++axis)
+	{
+		ab[axis] = vertices[1][axis] - vertices[0][axis];
+		ac[axis] = vertices[2][axis] - vertices[0][axis];
+		ap[axis] = point[axis] - vertices[0][axis];
+	}
+	const float d1{ dot(ab, ap) }, d2{ dot(ac, ap) };
+	if ((d1 <= 0.f) && (d2 <= 0.f))
+		return combine(0.f, 0.f);
+	float bp[3];
+	for (unsigned int axis{ 0u }; axis < 3u; ++axis)
+		bp[axis] = point[axis] - vertices[1][axis];
+	const float d3{ dot(ab, bp) }, d4{ dot(ac, bp) };
+	if ((d3 >= 0.f) && (d4 <= d3))
+		return combine(1.f, 0.f);
+	const float vc{ d1 * d4 - d3 * d2 };
+	if ((vc <= 0.f) && (d1 >= 0.f) && (d3 <= 0.f))
+		return combine(d1 / (d1 - d3), 0.f);
+	float cp[3];
+	for (unsigned int axis{ 0u }; axis < 3u; ++axis)
+		cp[axis] = point[axis] - vertices[2][axis];
+	const float d5{ dot(ab, cp) }, d6{ dot(ac, cp) };
+	if ((d6 >= 0.f) && (d5 <= d6))
+		return combine(0.f, 1.f);
+	const float vb{ d5 * d2 - d1 * d6 };
+	if ((vb <= 0.f) && (d2 >= 0.f) && (d6 <= 0.f))
+		return combine(0.f, d2 / (d2 - d6));
+	const float va{ d3 * d6 - d5 * d4 };
+	if ((va <= 0.f) && ((d4 - d3) >= 0.f) && ((d5 - d6) >= 0.f))
+	{
+		const float w{ (d4 - d3) / ((d4 - d3) + (d5 - d6)) };
+		return combine(1.f - w, w);
+	}
+	const float denominator{ 1.f / (va + vb + vc) };
+	combine(vb * denominator, vc * denominator);
+}
+
+// separating axis test: the box's axes, the triangle's normal and the cross products of the triangle's edges with the box's axes
+bool doesTriangleOverlapBox(const Objex::Vertex& a, const Objex::Vertex& b, const Objex::Vertex& c, const float centre[3], const float halfSize[3])
+{
+	const float vertices[3][3]{ { a.x - centre[0], a.y - centre[1], a.z - centre[2] }, { b.x - centre[0], b.y - centre[1], b.z - centre[2] }, { c.x - centre[0], c.y - centre[1], c.z - centre[2] } };
+	float edges[3][3];
+	for (unsigned int edge{ 0u }; edge < 3u; ++edge)
+	{
+		for (unsigned int axis{ 0u }; axis < 3u; ++axis)
+			edges[edge][axis] = vertices[(edge + 1) % 3][axis] - vertices[edge][axis];
+	}
+	auto isSeparating = [&](const float axis[3])
+	{
+		const float projections[3]{ dot(vertices[0], axis), dot(vertices[1], axis), dot(vertices[2], axis) };
+		const float radius{ halfSize[0] * std::abs(axis[0]) + halfSize[1] * std::abs(axis[1]) + halfSize[2] * std::abs(axis[2]) };
+		return (std::min(projections[0], std::min(projections[1], projections[2])) > radius) || (std::max(projections[0], std::max(projections[1], projections[2])) < -radius);
+	};
+	for (unsigned int boxAxis{ 0u }; boxAxis < 3u; ++boxAxis)
+	{
+		float axis[3]{ 0.f, 0.f, 0.f };
+		axis[boxAxis] = 1.f;
+		if (isSeparating(axis))
+			return false;
+		for (unsigned int edge{ 0u }; edge < 3u; ++edge)
+		{
+			float edgeAxis[3];
+			cross(edges[edge], axis, edgeAxis);
+			if (isSeparating(edgeAxis))
+				return false;
+		}
+	}
+	float normal[3];
+	cross(edges[0], edges[1], normal);
+	return !isSeparating(normal);
+}
+
+Objex::Box makeBox(const float minimum[3], const float maximum[3])
+{
+	Objex::Box box;
+	box.left = minimum[0];
+	box.right = maximum[0];
+	box.bottom = minimum[1];
+	box.top = maximum[1];
+	box.back = minimum[2];
+	box.front = maximum[2];
+	box.width = box.right - box.left;
+	box.height = box.top - box.bottom;
+	box.depth = box.front - box.back;
+	return box;
+}
+
+// bounds of each submesh's vertices (in order, or through indices if there are any)
+template <class Index>
+void refreshSubmeshBoxes(std::vector<Objex::Submesh>& submeshes, const std::vector<GLfloat>& positions, const std::vector<Index>& indices)
+{
+	for (auto& submesh : submeshes)
+	{
+		if (submesh.count == 0u)
+		{
+			submesh.localBoundingBox = Objex::Box();
+			continue;
+		}
+		float minimum[3]{ std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::max() };
+		float maximum[3]{ -std::numeric_limits<float>::max(), -std::numeric_limits<float>::max(), -std::numeric_limits<float>::max() };
+		if (indices.empty())
+			boundsKernel(positions.data() + submesh.first * 3, submesh.count, minimum, maximum);
+		else
+		{
+			// indexed vertices are shared between submeshes so each one is looked up
+			for (unsigned int i{ submesh.first }; i < submesh.first + submesh.count; ++i)
+			{
+				const GLfloat* const position{ positions.data() + static_cast<std::size_t>(indices[i]) * 3 };
+				for (unsigned int component{ 0u }; component < 3u; ++component)
+				{
+					minimum[component] = std::min(minimum[component], position[component]);
+					maximum[component] = std::max(maximum[component], position[component]);
+				}
+			}
+		}
+		submesh.localBoundingBox = makeBox(minimum, maximum);
+	}
+}
+
+// bounds, bounding sphere and normal cone of each cluster's triangles (in order, or through indices if there are any)
+template <class Index>
+void refreshClusterBounds(std::vector<Objex::Cluster>& clusters, const std::vector<GLfloat>& positions, const std::vector<Index>& indices)
+{
+	auto getPosition = [&](const unsigned int i)
+	{
+		return positions.data() + (indices.empty() ? static_cast<std::size_t>(i) : static_cast<std::size_t>(indices[i])) * 3;
+	};
+	std::vector<float> normals; // of each triangle (zero if it has no area)
+	for (auto& cluster : clusters)
+	{
+		const unsigned int end{ cluster.first + cluster.count };
+		if (cluster.count == 0u) // nothing to cull so it is never culled
+		{
+			cluster.localBoundingBox = Objex::Box();
+			cluster.center = cluster.coneApex = cluster.coneAxis = { 0.f, 0.f, 0.f };
+			cluster.radius = 0.f;
+			cluster.coneCutoff = 2.f;
+			continue;
+		}
+		float minimum[3]{ std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::max() };
+		float maximum[3]{ -std::numeric_limits<float>::max(), -std::numeric_limits<float>::max(), -std::numeric_limits<float>::max() };
+		for (unsigned int i{ cluster.first }; i < end; ++i)
+		{
+			const GLfloat* const position{ getPosition(i) };
+			for (unsigned int component{ 0u }; component < 3u; ++component)
+			{
+				minimum[component] = std::min(minimum[component], position[component]);
+				maximum[component] = std::max(maximum[component], position[component]);
+			}
+		}
+		cluster.localBoundingBox = makeBox(minimum, maximum);
+
+		// the sphere is centred on the box
+		const float center[3]{ (minimum[0] + maximum[0]) / 2, (minimum[1] + maximum[1]) / 2, (minimum[2] + maximum[2]) / 2 };
+		float radiusSquared{ 0.f };
+		for (unsigned int i{ cluster.first }; i < end; ++i)
+		{
+			const GLfloat* const position{ getPosition(i) };
+			const float offset[3]{ position[0] - center[0], position[1] - center[1], position[2] - center[2] };
+			radiusSquared = std::max(radiusSquared, dot(offset, offset));
+		}
+		cluster.center = { center[0], center[1], center[2] };
+		cluster.radius = std::sqrt(radiusSquared);
+
+		// the cone's axis is the average of the triangles' normals and its cutoff is from the widest angle to one of them
+		cluster.coneApex = cluster.center;
+		cluster.coneAxis = { 0.f, 0.f, 0.f };
+		cluster.coneCutoff = 2.f;
+		normals.assign(cluster.count, 0.f);
+		float axis[3]{ 0.f, 0.f, 0.f };
+		for (unsigned int i{ cluster.first }; i + 2 < end; i += 3)
+		{
+			const GLfloat* const a{ getPosition(i) };
+			const GLfloat* const b{ getPosition(i + 1) };
+			const GLfloat* const c{ getPosition(i + 2) };
+			const float edges[2][3]{ { b[0] - a[0], b[1] - a[1], b[2] - a[2] }, { c[0] - a[0], c[1] - a[1], c[2] - a[2] } };
+			float* const normal{ normals.data() + (i - cluster.first) };
+			cross(edges[0], edges[1], normal);
+			if (!normalize(normal))
+				normal[0] = normal[1] = normal[2] = 0.f;
+			for (unsigned int component{ 0u }; component < 3u; ++component)
+				axis[component] += normal[component];
+		}
+		if (!normalize(axis))
+			continue;
+		cluster.coneAxis = { axis[0], axis[1], axis[2] };
+		float minimumDot{ 1.f };
+		for (std::size_t triangle{ 0u }; triangle + 2 < normals.size(); triangle += 3)
+		{
+			if ((normals[triangle] != 0.f) || (normals[triangle + 1] != 0.f) || (normals[triangle + 2] != 0.f))
+				minimumDot = std::min(minimumDot, dot(normals.data() + triangle, axis));
+		}
+		if (minimumDot <= 0.1f) // the triangles face (almost) opposite directions
+			continue;
+
+		// the apex is moved back along the axis until it is behind every triangle's plane
+		float maximumDistance{ 0.f };
+		for (unsigned int i{ cluster.first }; i + 2 < end; i += 3)
+		{
+			const float* const normal{ normals.data() + (i - cluster.first) };
+			const GLfloat* const a{ getPosition(i) };
+			const float toCenter[3]{ center[0] - a[0], center[1] - a[1], center[2] - a[2] };
+			const float axisDot{ dot(axis, normal) };
+			if (axisDot > 0.f)
+				maximumDistance = std::max(maximumDistance, dot(toCenter, normal) / axisDot);
+		}
+		cluster.coneApex = { center[0] - axis[0] * maximumDistance, center[1] - axis[1] * maximumDistance, center[2] - axis[2] * maximumDistance };
+		cluster.coneCutoff = std::sqrt(1.f - minimumDot * minimumDot);
+	}
+}
+
+// material colour from an .mtl line: "r g b" or just "r" (for grey). other forms (e.g. "spectral") are not supported
+bool parseMaterialColor(const char* begin, const char* end, Objex::Vertex& color)
+{
+	float components[3];
+	unsigned int numberOfTokens{ 0u };
+	const char* tokenBegin;
+	const char* tokenEnd;
+	while ((numberOfTokens < 3u) && nextToken(begin, end, tokenBegin, tokenEnd))
+	{
+		if (!parseFloat(tokenBegin, tokenEnd, components[numberOfTokens]))
+			return false;
+		++numberOfTokens;
+	}
+	if (numberOfTokens == 0u)
+		return false;
+	if (numberOfTokens < 3u)
+		components[1] = components[2] = components[0];
+	color = { components[0], components[1], components[2] };
+	return true;
+}
+
+} // namespace
+
+// memory used only while loading. it is reused by each block and released all at once when loading finishes
+struct Objex::ParseScratch
+{
+	std::vector<const char*> chunkBoundaries;
+	std::vector<ParsedChunk> chunks;
+	FaceNameList materials;
+	FaceNameList groups;
+	FaceNameList objects;
+
+	std::size_t getMemoryUsage() const // in bytes (excluding strings)
+	{
+		std::size_t size{ getAllocatedSize(chunkBoundaries) + getAllocatedSize(chunks) };
+		for (const auto& chunk : chunks)
+		{
+			size += getAllocatedSize(chunk.vertices) + getAllocatedSize(chunk.normals) + getAllocatedSize(chunk.textures) + getAllocatedSize(chunk.faceFirstCorners) +
+				getAllocatedSize(chunk.faceVertexIndices) + getAllocatedSize(chunk.faceNormalIndices) + getAllocatedSize(chunk.faceTextureIndices) + getAllocatedSize(chunk.relativeIndices);
+		}
+		return size;
+	}
+};
+
 Objex::Objex()
 {
 }
 
-void Objex::refreshData()
+Objex::Objex(const Objex& other) = default;
+
+// the arrays are swapped, not copied, so the data pointers stay valid. a moved-from object is left as if just constructed (e.g. with one face first corner)
+Objex::Objex(Objex&& other)
+	: Objex()
+{
+	swapMembers(other);
+}
+
+Objex& Objex::operator=(Objex&& other)
+{
+	if (this != &other)
+	{
+		Objex moved;
+		moved.swapMembers(other);
+		swapMembers(moved);
+	}
+	return *this;
+}
+
+void Objex::swapMembers(Objex& other)
+{
+	using std::swap;
+	swap(vertexData, other.vertexData);
+	swap(normalData, other.normalData);
+	swap(textureData, other.textureData);
+	swap(colorData, other.colorData);
+	swap(tangentData, other.tangentData);
+	swap(indexData, other.indexData);
+	swap(interleavedData, other.interleavedData);
+	swap(mVertexArray, other.mVertexArray);
+	swap(mNormalArray, other.mNormalArray);
+	swap(mTextureArray, other.mTextureArray);
+	swap(mColorArray, other.mColorArray);
+	swap(mShortIndexArray, other.mShortIndexArray);
+	swap(mIndexArray, other.mIndexArray);
+	swap(mIndexedVertexCorners, other.mIndexedVertexCorners);
+	swap(mUnoptimizedVertexCacheStatistics, other.mUnoptimizedVertexCacheStatistics);
+	swap(mTangentArray, other.mTangentArray);
+	swap(mInterleavedArray, other.mInterleavedArray);
+	swap(mInterleavedStride, other.mInterleavedStride);
+	swap(mInterleavedOffsets, other.mInterleavedOffsets);
+	swap(mPositionDequantization, other.mPositionDequantization);
+	swap(mVertices, other.mVertices);
+	swap(mNormals, other.mNormals);
+	swap(mTextures, other.mTextures);
+	swap(mFaceFirstCorners, other.mFaceFirstCorners);
+	swap(mFaceVertexIndices, other.mFaceVertexIndices);
+	swap(mFaceNormalIndices, other.mFaceNormalIndices);
+	swap(mFaceTextureIndices, other.mFaceTextureIndices);
+	swap(mFaceMaterials, other.mFaceMaterials);
+	swap(mFaceGroups, other.mFaceGroups);
+	swap(mFaceObjects, other.mFaceObjects);
+	swap(mMaterials, other.mMaterials);
+	swap(mGroupNames, other.mGroupNames);
+	swap(mObjectNames, other.mObjectNames);
+	swap(mMaterialLibraries, other.mMaterialLibraries);
+	swap(mFaceOrder, other.mFaceOrder);
+	swap(mSubmeshes, other.mSubmeshes);
+	swap(mClusterFirstFaces, other.mClusterFirstFaces);
+	swap(mClusters, other.mClusters);
+	swap(mLevelsOfDetail, other.mLevelsOfDetail);
+	swap(mBvhNodes, other.mBvhNodes);
+	swap(mBvhTriangles, other.mBvhTriangles);
+	swap(mBvhOptions, other.mBvhOptions);
+	swap(mLocalBoundingBox, other.mLocalBoundingBox);
+	swap(mIsLocalBoundingBoxOutdated, other.mIsLocalBoundingBoxOutdated);
+	swap(mChangedVertices, other.mChangedVertices);
+	swap(mChangedNormals, other.mChangedNormals);
+	swap(mChangedTextures, other.mChangedTextures);
+	swap(mAreFacesChanged, other.mAreFacesChanged);
+	swap(mIsEditing, other.mIsEditing);
+	swap(mHasSourceData, other.mHasSourceData);
+	swap(mVertexOutputMap, other.mVertexOutputMap);
+	swap(mNormalOutputMap, other.mNormalOutputMap);
+	swap(mTextureOutputMap, other.mTextureOutputMap);
+	swap(mCommentLines, other.mCommentLines);
+	swap(mUnprocessedLines, other.mUnprocessedLines);
+	swap(mLoadOptions, other.mLoadOptions);
+	swap(mLoadStats, other.mLoadStats);
+	swap(mOutputOptions, other.mOutputOptions);
+	swap(mNumberOfParsedLines, other.mNumberOfParsedLines);
+}
+
+std::unique_ptr<Objex> Objex::clone() const
+{
+	std::unique_ptr<Objex> copy(new Objex(*this));
+	copy->refreshDataPointers();
+	return copy;
+}
+
+void Objex::refreshData()
+{
+	if (!mHasSourceData)
+	{
+		std::cerr << "Output cannot be recreated without source data." << std::endl;
+		return;
+	}
+
+	mVertexArray.resize(0);
+	mNormalArray.resize(0);
+	mTextureArray.resize(0);
+	mShortIndexArray.clear();
+	mIndexArray.clear();
+	mIndexedVertexCorners.clear();
+	mLevelsOfDetail.clear();
+	indexData = nullptr;
+	refreshFaceOrder();
+	if (mOutputOptions.indexed)
+		refreshIndexedData();
+	else
+	{
+		// each face's first triangle in the output is the number of triangles before it in output order (an exclusive prefix sum of the faces' triangle counts)
+		// arrays are sized exactly and each face writes only its own part so faces can be processed in any order (or in parallel) with identical results
+		const std::size_t numberOfFaces{ getNumberOfFaces() };
+		std::vector<std::size_t> faceFirstTriangles(numberOfFaces + 1, 0u);
+		for (std::size_t position{ 0u }; position < numberOfFaces; ++position)
+		{
+			const unsigned int face{ mFaceOrder[position] };
+			const unsigned int numberOfCorners{ mFaceFirstCorners[face + 1] - mFaceFirstCorners[face] };
+			faceFirstTriangles[position + 1] = faceFirstTriangles[position] + ((numberOfCorners >= 3) ? numberOfCorners - 2 : 0u);
+		}
+		mVertexArray.resize(faceFirstTriangles.back() * 9u);
+		mNormalArray.resize(faceFirstTriangles.back() * 9u);
+		mTextureArray.resize(faceFirstTriangles.back() * 9u);
+
+		const unsigned int numberOfThreads{ getNumberOfThreads(mOutputOptions.numberOfThreads) };
+		const std::size_t numberOfTasks{ std::max<std::size_t>(std::min<std::size_t>(numberOfThreads * 4u, numberOfFaces / minimumFacesPerTask), 1u) };
+		runInParallel(numberOfTasks, numberOfThreads, [&](const std::size_t task)
+		{
+			for (std::size_t position{ numberOfFaces * task / numberOfTasks }; position < numberOfFaces * (task + 1) / numberOfTasks; ++position)
+			{
+				const unsigned int face{ mFaceOrder[position] };
+				const unsigned int firstCorner{ mFaceFirstCorners[face] };
+				const std::size_t numberOfCorners{ mFaceFirstCorners[face + 1] - firstCorner };
+				const std::size_t firstElement{ faceFirstTriangles[position] * 9u };
+				transferFaceToArray(mFaceVertexIndices.data() + firstCorner, numberOfCorners, mVertices, mVertexArray.data() + firstElement);
+				transferFaceToArray(mFaceNormalIndices.data() + firstCorner, numberOfCorners, mNormals, mNormalArray.data() + firstElement, Vertex{ 0, 0, 1 });
+				transferFaceToArray(mFaceTextureIndices.data() + firstCorner, numberOfCorners, mTextures, mTextureArray.data() + firstElement);
+			}
+		});
+	}
+	// arrays are reused (and indexed output is appended) so any excess capacity is released
+	mVertexArray.shrink_to_fit();
+	mNormalArray.shrink_to_fit();
+	mTextureArray.shrink_to_fit();
+	vertexData = mVertexArray.data();
+	normalData = mNormalArray.data();
+	textureData = mTextureArray.data();
+
+	refreshTangentData();
+	refreshLocalBoundingBox(); // before the interleaved data as positions may be quantized to it
+	refreshInterleavedData();
+	refreshSubmeshes();
+	if (!mBvhNodes.empty())
+	{
+		if (mAreFacesChanged)
+			buildBvh(mBvhOptions);
+		else if (!mChangedVertices.empty())
+			refitBvh();
+	}
+	clearChanges();
+}
+
+Objex::ChangedRanges Objex::refreshChangedData()
+{
+	ChangedRanges changedRanges;
+	// tangents depend on the neighbouring vertices (and normals and texture vertices) so any change recreates the output
+	if (mAreFacesChanged || (mOutputOptions.tangents && !(mChangedVertices.empty() && mChangedNormals.empty() && mChangedTextures.empty())))
+	{
+		const std::size_t previousNumberOfVertices{ mVertexArray.size() };
+		refreshData();
+		if (mVertexArray.size() != previousNumberOfVertices)
+			createColorArray();
+		changedRanges.vertex.push_back({ 0u, mVertexArray.size() * sizeof(GLfloat) });
+		changedRanges.normal.push_back({ 0u, mNormalArray.size() * sizeof(GLfloat) });
+		changedRanges.texture.push_back({ 0u, mTextureArray.size() * sizeof(GLfloat) });
+		if (!mTangentArray.empty())
+			changedRanges.tangent.push_back({ 0u, mTangentArray.size() * sizeof(GLfloat) });
+		if (!mInterleavedArray.empty())
+			changedRanges.interleaved.push_back({ 0u, mInterleavedArray.size() });
+		return changedRanges;
+	}
+	if (mChangedVertices.empty() && mChangedNormals.empty() && mChangedTextures.empty())
+		return changedRanges;
+
+	if (mVertexOutputMap.first.empty())
+		buildOutputVertexMaps();
+
+	// rewrite the output vertices that use changed elements and merge consecutive output vertices into ranges
+	auto toRanges = [](std::vector<unsigned int>& outputVertices, const std::size_t stride, std::vector<ByteRange>& ranges)
+	{
+		std::sort(outputVertices.begin(), outputVertices.end());
+		outputVertices.erase(std::unique(outputVertices.begin(), outputVertices.end()), outputVertices.end());
+		for (const auto& outputVertex : outputVertices)
+		{
+			if (!ranges.empty() && (ranges.back().offset + ranges.back().size == outputVertex * stride))
+				ranges.back().size += stride;
+			else
+				ranges.push_back({ outputVertex * stride, stride });
+		}
+	};
+	std::vector<unsigned int> changedVertexOutput;
+	std::vector<unsigned int> changedNormalOutput;
+	std::vector<unsigned int> changedTextureOutput;
+	refreshChangedElements(mChangedVertices, mVertices, mVertexOutputMap, mVertexArray, changedVertexOutput);
+	refreshChangedElements(mChangedNormals, mNormals, mNormalOutputMap, mNormalArray, changedNormalOutput);
+	refreshChangedElements(mChangedTextures, mTextures, mTextureOutputMap, mTextureArray, changedTextureOutput);
+	std::vector<unsigned int> changedOutput;
+	if (!mInterleavedArray.empty())
+	{
+		changedOutput.insert(changedOutput.end(), changedVertexOutput.begin(), changedVertexOutput.end());
+		changedOutput.insert(changedOutput.end(), changedNormalOutput.begin(), changedNormalOutput.end());
+		changedOutput.insert(changedOutput.end(), changedTextureOutput.begin(), changedTextureOutput.end());
+	}
+	toRanges(changedVertexOutput, 3 * sizeof(GLfloat), changedRanges.vertex);
+	toRanges(changedNormalOutput, 3 * sizeof(GLfloat), changedRanges.normal);
+	toRanges(changedTextureOutput, 3 * sizeof(GLfloat), changedRanges.texture);
+	// quantized positions depend on the bounding box so, if it changed, every interleaved vertex is rewritten
+	const Dequantization previousDequantization{ mPositionDequantization };
+	const Dequantization dequantization{ (!mInterleavedArray.empty() && !mChangedVertices.empty()) ? calculatePositionDequantization() : previousDequantization };
+	if (std::memcmp(&dequantization, &previousDequantization, sizeof(Dequantization)) != 0)
+	{
+		refreshInterleavedData();
+		changedRanges.interleaved.push_back({ 0u, mInterleavedArray.size() });
+	}
+	else
+	{
+		toRanges(changedOutput, mInterleavedStride, changedRanges.interleaved);
+		for (const auto& outputVertex : changedOutput)
+			writeInterleavedVertex(outputVertex);
+	}
+	if (!mChangedVertices.empty())
+	{
+		refreshSubmeshBounds();
+		refitBvh();
+	}
+
+	mChangedVertices.clear();
+	mChangedNormals.clear();
+	mChangedTextures.clear();
+	return changedRanges;
+}
+
+bool Objex::loadFromFile(const std::string& filename)
+{
+	return loadFromFile(filename, LoadOptions());
+}
+
+bool Objex::loadFromFile(const std::string& filename, const LoadOptions& options)
+{
+	Stopwatch totalStopwatch;
+	mLoadStats = LoadStats();
+	if (isCancelled(options))
+		return false;
+
+	// material libraries are named relative to the .obj file
+	const std::string directory(filename, 0u, filename.find_last_of("/\\") + 1u);
+	Stopwatch stopwatch;
+	if (!options.useCache)
+	{
+		if (!loadFromObjFile(filename, options))
+			return false;
+		stopwatch.restart();
+		loadMaterialLibraries(directory);
+		mLoadStats.materialTime = stopwatch.restart();
+		mLoadStats.totalTime = totalStopwatch.restart();
+		return true;
+	}
+
+	struct stat filestatus;
+	if (stat(filename.c_str(), &filestatus) != 0)
+		return false;
+	const unsigned long long fileSize{ static_cast<unsigned long long>(filestatus.st_size) };
+	const long long fileModificationTime{ static_cast<long long>(filestatus.st_mtime) };
+	const std::string cacheFilename{ options.cacheFilename.empty() ? filename + ".objexcache" : options.cacheFilename };
+	// the output may be recreated from the cache's data so it needs the options first
+	mLoadOptions = options;
+	if (loadFromCacheFile(cacheFilename, fileSize, fileModificationTime, options))
+	{
+		stopwatch.restart();
+		loadMaterialLibraries(directory);
+		mLoadStats.materialTime = stopwatch.restart();
+		mLoadStats.totalTime = totalStopwatch.restart();
+		return true;
+	}
+	// the cache is written from the source data so it is released afterwards
+	LoadOptions objOptions(options);
+	objOptions.keepSourceData = true;
+	if (!loadFromObjFile(filename, objOptions))
+		return false;
+	mLoadOptions = options;
+	stopwatch.restart();
+	if (!saveToCacheFile(cacheFilename, fileSize, fileModificationTime))
+		std::cerr << "Unable to write cache: " << cacheFilename << std::endl;
+	mLoadStats.cacheTime = stopwatch.restart();
+	loadMaterialLibraries(directory);
+	mLoadStats.materialTime = stopwatch.restart();
+	if (!options.keepSourceData)
+		releaseSourceData();
+	mLoadStats.totalTime = totalStopwatch.restart();
+	return true;
+}
+
+std::future<bool> Objex::loadFromFileAsync(const std::string& filename)
+{
+	return loadFromFileAsync(filename, LoadOptions());
+}
+
+std::future<bool> Objex::loadFromFileAsync(const std::string& filename, const LoadOptions& options)
+{
+	return std::async(std::launch::async, [this, filename, options]() { return loadFromFile(filename, options); });
+}
+
+bool Objex::loadFromMemory(const char* data, std::size_t size)
+{
+	return loadFromMemory(data, size, LoadOptions());
+}
+
+bool Objex::loadFromMemory(const char* data, std::size_t size, const LoadOptions& options)
+{
+	Stopwatch stopwatch;
+	mLoadStats = LoadStats();
+	const bool isLoaded{ parseMemory(data, size, options) };
+	mLoadStats.totalTime = stopwatch.restart();
+	return isLoaded;
+}
+
+bool Objex::parseMemory(const char* data, std::size_t size, const LoadOptions& options)
+{
+	clear();
+	mLoadOptions = options;
+	mLoadStats.bytes = size;
+
+	// parse in slices (split at line boundaries) so that progress can be shown
+	const std::size_t sliceSize{ bufferedBlockSize * getNumberOfThreads(options.numberOfThreads) };
+	const char* const end{ data + size };
+	const char* sliceBegin{ data };
+	unsigned int previousProgress{ 0u };
+	ParseScratch scratch;
+	Stopwatch stopwatch;
+	while (sliceBegin != end)
+	{
+		const char* sliceEnd{ sliceBegin + std::min<std::size_t>(sliceSize, end - sliceBegin) };
+		while ((sliceEnd != end) && (*(sliceEnd - 1) != '\n'))
+			++sliceEnd;
+		if (!parseBlock(sliceBegin, sliceEnd, scratch))
+		{
+			std::cerr << "Importing failed!" << std::endl;
+			return false;
+		}
+		if (isCancelled(options))
+		{
+			if (options.logInformation)
+				std::clog << "Importing cancelled." << std::endl;
+			clear();
+			return false;
+		}
+		sliceBegin = sliceEnd;
+
+		if (options.progressCallback)
+			options.progressCallback({ static_cast<unsigned long long>(sliceBegin - data), size, mNumberOfParsedLines });
+		if (options.logInformation)
+			logProgress("Parsing", sliceBegin - data, size, previousProgress);
+	}
+	mLoadStats.parseTime += stopwatch.restart();
+	recordPeakMemory(scratch.getMemoryUsage());
+
+	return finishLoad();
+}
+
+Objex::BatchLoader::BatchLoader(const unsigned int numberOfThreads)
+	: mCancel{ std::make_shared<std::atomic<bool>>(false) }
+{
+	const unsigned int numberOfWorkers{ getNumberOfThreads(numberOfThreads) };
+	for (unsigned int worker{ 0u }; worker < numberOfWorkers; ++worker)
+		mThreads.emplace_back(&BatchLoader::work, this);
+}
+
+Objex::BatchLoader::~BatchLoader()
+{
+	cancel();
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mIsStopping = true;
+	}
+	mRequestAdded.notify_all();
+	for (auto& thread : mThreads)
+		thread.join();
+}
+
+std::size_t Objex::BatchLoader::add(const std::string& filename)
+{
+	return add(filename, LoadOptions(), OutputOptions());
+}
+
+std::size_t Objex::BatchLoader::add(const std::string& filename, const LoadOptions& loadOptions)
+{
+	return add(filename, loadOptions, OutputOptions());
+}
+
+std::size_t Objex::BatchLoader::add(const std::string& filename, const LoadOptions& loadOptions, const OutputOptions& outputOptions)
+{
+	std::size_t number;
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		number = mNumberOfRequests++;
+		++mNumberOfUnfinished;
+		mRequests.push_back({ number, filename, loadOptions, outputOptions });
+		mRequests.back().loadOptions.cancel = mCancel;
+	}
+	mRequestAdded.notify_one();
+	return number;
+}
+
+void Objex::BatchLoader::setCallback(std::function<void(Result&&)> callback)
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	mCallback = std::move(callback);
+}
+
+std::vector<Objex::BatchLoader::Result> Objex::BatchLoader::takeFinished()
+{
+	std::vector<Result> finished;
+	std::lock_guard<std::mutex> lock(mMutex);
+	finished.swap(mFinished);
+	return finished;
+}
+
+void Objex::BatchLoader::wait()
+{
+	std::unique_lock<std::mutex> lock(mMutex);
+	mRequestFinished.wait(lock, [this]() { return mNumberOfUnfinished == 0u; });
+}
+
+void Objex::BatchLoader::cancel()
+{
+	// loads already added keep the old (now cancelled) flag so fail quickly when they are reached
+	std::lock_guard<std::mutex> lock(mMutex);
+	mCancel->store(true);
+	mCancel = std::make_shared<std::atomic<bool>>(false);
+}
+
+std::size_t Objex::BatchLoader::getNumberOfUnfinished() const
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	return mNumberOfUnfinished;
+}
+
+void Objex::BatchLoader::work()
+{
+	while (true)
+	{
+		Request request;
+		std::function<void(Result&&)> callback;
+		{
+			std::unique_lock<std::mutex> lock(mMutex);
+			mRequestAdded.wait(lock, [this]() { return mIsStopping || !mRequests.empty(); });
+			if (mRequests.empty())
+				return;
+			request = std::move(mRequests.front());
+			mRequests.pop_front();
+			callback = mCallback;
+		}
+
+		// files are read (or mapped) and parsed by the same thread so reading one file overlaps with parsing others
+		Result result{ request.number, request.filename, nullptr };
+		if (!isCancelled(request.loadOptions))
+		{
+			std::unique_ptr<Objex> objex(new Objex);
+			objex->setOutputOptions(request.outputOptions);
+			if (objex->loadFromFile(request.filename, request.loadOptions))
+				result.objex = std::move(objex);
+		}
+
+		if (callback)
+			callback(std::move(result));
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			if (!callback)
+				mFinished.push_back(std::move(result));
+			--mNumberOfUnfinished;
+		}
+		mRequestFinished.notify_all();
+	}
+}
+
+Objex::Registry& Objex::Registry::getGlobal()
+{
+	static Registry registry;
+	return registry;
+}
+
+std::shared_ptr<const Objex> Objex::Registry::load(const std::string& filename)
+{
+	return load(filename, LoadOptions(), OutputOptions());
+}
+
+std::shared_ptr<const Objex> Objex::Registry::load(const std::string& filename, const LoadOptions& loadOptions)
+{
+	return load(filename, loadOptions, OutputOptions());
+}
+
+std::shared_ptr<const Objex> Objex::Registry::load(const std::string& filename, const LoadOptions& loadOptions, const OutputOptions& outputOptions)
+{
+	const std::string key{ getRegistryKey(filename, loadOptions, outputOptions) };
+	if (key.empty())
+		return nullptr;
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		const auto found = mMeshes.find(key);
+		if (found != mMeshes.end())
+		{
+			std::shared_ptr<const Objex> mesh{ found->second.lock() };
+			if (mesh)
+				return mesh;
+		}
+	}
+
+	// loaded without the lock so that other files can be loaded at the same time. if two threads load the same file at once, the one that finishes first is shared
+	std::shared_ptr<Objex> mesh{ std::make_shared<Objex>() };
+	mesh->setOutputOptions(outputOptions);
+	if (!mesh->loadFromFile(filename, loadOptions))
+		return nullptr;
+	mesh->getLocalBoundingBox(); // so that it is never refreshed (written) while shared
+
+	std::lock_guard<std::mutex> lock(mMutex);
+	for (auto entry = mMeshes.begin(); entry != mMeshes.end();) // forget meshes that are no longer used
+	{
+		if (entry->second.expired())
+			entry = mMeshes.erase(entry);
+		else
+			++entry;
+	}
+	std::weak_ptr<const Objex>& entry(mMeshes[key]);
+	std::shared_ptr<const Objex> existing{ entry.lock() };
+	if (existing)
+		return existing;
+	entry = mesh;
+	return mesh;
+}
+
+std::size_t Objex::Registry::getNumberOfMeshes() const
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	return std::count_if(mMeshes.begin(), mMeshes.end(), [](const std::pair<const std::string, std::weak_ptr<const Objex>>& entry) { return !entry.second.expired(); });
+}
+
+void Objex::Registry::clear()
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	mMeshes.clear();
+}
+
+Objex::Instance::Instance(std::shared_ptr<const Objex> mesh)
+	: mSharedMesh{ std::move(mesh) }
+{
+}
+
+Objex::Instance::Instance(const Instance& other)
+	: mSharedMesh{ other.mSharedMesh }
+	, mOwnMesh{ other.mOwnMesh ? other.mOwnMesh->clone() : nullptr }
+{
+}
+
+Objex::Instance::Instance(Instance&& other) = default;
+
+Objex::Instance::~Instance() = default;
+
+Objex::Instance& Objex::Instance::operator=(const Instance& other)
+{
+	if (this != &other)
+	{
+		mSharedMesh = other.mSharedMesh;
+		mOwnMesh = other.mOwnMesh ? other.mOwnMesh->clone() : nullptr;
+	}
+	return *this;
+}
+
+Objex::Instance& Objex::Instance::operator=(Instance&& other) = default;
+
+const Objex& Objex::Instance::get() const
+{
+	// never changed (and nothing in it is refreshed on request) so it is safe to share between threads
+	static const Objex emptyMesh;
+	if (mOwnMesh)
+		return *mOwnMesh;
+	return mSharedMesh ? *mSharedMesh : emptyMesh;
+}
+
+const Objex* Objex::Instance::operator->() const
+{
+	return &get();
+}
+
+Objex& Objex::Instance::edit()
+{
+	if (!mOwnMesh)
+	{
+		mOwnMesh = mSharedMesh ? mSharedMesh->clone() : std::unique_ptr<Objex>(new Objex);
+		mSharedMesh.reset();
+	}
+	return *mOwnMesh;
+}
+
+bool Objex::Instance::isShared() const
+{
+	return !mOwnMesh && mSharedMesh;
+}
+
+bool Objex::Instance::hasMesh() const
+{
+	return mOwnMesh || mSharedMesh;
+}
+
+bool Objex::loadMaterialLibrary(const std::string& filename)
+{
+	std::ifstream file(filename);
+	if (!file.is_open())
+		return false;
+
+	if (mLoadOptions.logInformation)
+		std::clog << "Importing .mtl: " << filename << std::endl;
+	int material{ -1 };
+	std::string line;
+	while (std::getline(file, line))
+	{
+		const char* cursor{ line.data() };
+		const char* const end{ trimWhitespaceRight(cursor, line.data() + line.size()) };
+		const char* keywordBegin;
+		const char* keywordEnd;
+		if (!nextToken(cursor, end, keywordBegin, keywordEnd) || (*keywordBegin == '#'))
+			continue;
+		if (isKeyword(keywordBegin, keywordEnd, "newmtl"))
+		{
+			const std::string name(skipWhitespace(cursor, end), end);
+			const auto found = std::find_if(mMaterials.begin(), mMaterials.end(), [&](const Material& existing) { return existing.name == name; });
+			material = static_cast<int>(found - mMaterials.begin());
+			if (found == mMaterials.end())
+			{
+				mMaterials.emplace_back();
+				mMaterials.back().name = name;
+			}
+			mMaterials[material].isDefined = true;
+			continue;
+		}
+		if (material < 0) // properties before the first material are ignored
+			continue;
+
+		// unsupported or malformed properties are ignored
+		Material& current(mMaterials[material]);
+		const char* tokenBegin;
+		const char* tokenEnd;
+		float value;
+		if (isKeyword(keywordBegin, keywordEnd, "Ka"))
+			parseMaterialColor(cursor, end, current.ambient);
+		else if (isKeyword(keywordBegin, keywordEnd, "Kd"))
+			parseMaterialColor(cursor, end, current.diffuse);
+		else if (isKeyword(keywordBegin, keywordEnd, "Ks"))
+			parseMaterialColor(cursor, end, current.specular);
+		else if (isKeyword(keywordBegin, keywordEnd, "Ns") && nextToken(cursor, end, tokenBegin, tokenEnd) && parseFloat(tokenBegin, tokenEnd, value))
+			current.shininess = value;
+		else if (isKeyword(keywordBegin, keywordEnd, "d") && nextToken(cursor, end, tokenBegin, tokenEnd) && parseFloat(tokenBegin, tokenEnd, value))
+			current.opacity = value;
+		else if (isKeyword(keywordBegin, keywordEnd, "Tr") && nextToken(cursor, end, tokenBegin, tokenEnd) && parseFloat(tokenBegin, tokenEnd, value))
+			current.opacity = 1.f - value;
+		else if (isKeyword(keywordBegin, keywordEnd, "map_Kd"))
+		{
+			// the filename is last (after any options)
+			while (nextToken(cursor, end, tokenBegin, tokenEnd))
+				current.diffuseTexture.assign(tokenBegin, tokenEnd);
+		}
+	}
+	return true;
+}
+
+void Objex::setOutputOptions(const OutputOptions& options)
+{
+	if (!mHasSourceData)
+	{
+		std::cerr << "Output options cannot be changed without source data." << std::endl;
+		return;
+	}
+	const bool requiresNewColors{ options.indexed != mOutputOptions.indexed };
+	mOutputOptions = options;
+	if (getNumberOfFaces() == 0u)
+		return;
+	refreshData();
+	if (requiresNewColors)
+		createColorArray();
+}
+
+Objex::OutputOptions Objex::getOutputOptions() const
+{
+	return mOutputOptions;
+}
+
+Objex::Vertex Objex::getLocalBoundingBoxCenter() const
+{
+	if (mIsLocalBoundingBoxOutdated)
+		refreshLocalBoundingBox();
+	return{ mLocalBoundingBox.width / 2 + mLocalBoundingBox.left, mLocalBoundingBox.height / 2 + mLocalBoundingBox.bottom, mLocalBoundingBox.depth / 2 + mLocalBoundingBox.back };
+}
+
+Objex::Box Objex::getLocalBoundingBox() const
+{
+	if (mIsLocalBoundingBoxOutdated)
+		refreshLocalBoundingBox();
+	return mLocalBoundingBox;
+}
+
+unsigned int Objex::getNumberOfVertices() const
+{
+	return mVertexArray.size() / 3;
+}
+
+unsigned int Objex::getNumberOfTriangles() const
+{
+	if (mOutputOptions.indexed)
+		return getNumberOfIndices() / 3;
+	return getNumberOfVertices() / 3;
+}
+
+unsigned int Objex::getNumberOfIndices() const
+{
+	return mShortIndexArray.size() + mIndexArray.size();
+}
+
+GLenum Objex::getIndexType() const
+{
+	return mIndexArray.empty() ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+}
+
+unsigned int Objex::getInterleavedStride() const
+{
+	return mInterleavedStride;
+}
+
+int Objex::getInterleavedOffset(const Attribute attribute) const
+{
+	return mInterleavedOffsets[static_cast<int>(attribute)];
+}
+
+Objex::Dequantization Objex::getPositionDequantization() const
+{
+	return mPositionDequantization;
+}
+
+std::vector<Objex::AttributeFormat> Objex::getCompactInterleavedLayout()
+{
+	return{
+		{ Attribute::Position, 3u, ComponentType::NormalizedUnsignedShort, Encoding::BoundingBox },
+		{ Attribute::Normal, 2u, ComponentType::NormalizedShort, Encoding::Octahedral },
+		{ Attribute::Texture, 2u, ComponentType::HalfFloat, Encoding::None },
+		{ Attribute::Color, 4u, ComponentType::NormalizedUnsignedByte, Encoding::None }
+	};
+}
+
+Objex::VertexCacheStatistics Objex::getVertexCacheStatistics() const
+{
+	const unsigned int cacheSize{ std::max(mOutputOptions.vertexCacheSize, 1u) };
+	if (!mShortIndexArray.empty())
+		return simulateVertexCache(mShortIndexArray.data(), mShortIndexArray.size(), getNumberOfVertices(), cacheSize);
+	if (!mIndexArray.empty())
+		return simulateVertexCache(mIndexArray.data(), mIndexArray.size(), getNumberOfVertices(), cacheSize);
+	VertexCacheStatistics statistics;
+	if (getNumberOfVertices() > 0u)
+	{
+		statistics.acmr = 3.f;
+		statistics.atvr = 1.f;
+	}
+	return statistics;
+}
+
+Objex::VertexCacheStatistics Objex::getUnoptimizedVertexCacheStatistics() const
+{
+	if (!mOutputOptions.indexed)
+		return getVertexCacheStatistics();
+	return mUnoptimizedVertexCacheStatistics;
+}
+
+const Objex::LoadStats& Objex::getLoadStats() const
+{
+	return mLoadStats;
+}
+
+Objex::MemoryUsage Objex::getMemoryUsage() const
+{
+	MemoryUsage usage;
+	usage.elements = getAllocatedSize(mVertices) + getAllocatedSize(mNormals) + getAllocatedSize(mTextures);
+	usage.faces = getAllocatedSize(mFaceFirstCorners) + getAllocatedSize(mFaceVertexIndices) + getAllocatedSize(mFaceNormalIndices) + getAllocatedSize(mFaceTextureIndices) +
+		getAllocatedSize(mFaceMaterials) + getAllocatedSize(mFaceGroups) + getAllocatedSize(mFaceObjects) + getAllocatedSize(mFaceOrder);
+	usage.lines = getAllocatedSize(mCommentLines) + getAllocatedSize(mUnprocessedLines);
+	usage.output = getAllocatedSize(mVertexArray) + getAllocatedSize(mNormalArray) + getAllocatedSize(mTextureArray) + getAllocatedSize(mColorArray) + getAllocatedSize(mTangentArray);
+	usage.indices = getAllocatedSize(mShortIndexArray) + getAllocatedSize(mIndexArray) + getAllocatedSize(mIndexedVertexCorners);
+	usage.interleaved = getAllocatedSize(mInterleavedArray);
+	usage.levelsOfDetail = getAllocatedSize(mLevelsOfDetail);
+	for (const auto& level : mLevelsOfDetail)
+		usage.levelsOfDetail += getAllocatedSize(level.shortIndices) + getAllocatedSize(level.indices) + getAllocatedSize(level.submeshes);
+	usage.bvh = getAllocatedSize(mBvhNodes) + getAllocatedSize(mBvhTriangles);
+	usage.editing = getAllocatedSize(mChangedVertices) + getAllocatedSize(mChangedNormals) + getAllocatedSize(mChangedTextures);
+	for (const auto* map : { &mVertexOutputMap, &mNormalOutputMap, &mTextureOutputMap })
+		usage.editing += getAllocatedSize(map->first) + getAllocatedSize(map->outputVertices);
+	usage.other = getAllocatedSize(mMaterials) + getAllocatedSize(mGroupNames) + getAllocatedSize(mObjectNames) + getAllocatedSize(mMaterialLibraries) + getAllocatedSize(mSubmeshes);
+	for (const auto& material : mMaterials)
+		usage.other += getAllocatedSize(material.name) + getAllocatedSize(material.diffuseTexture);
+	usage.total = usage.elements + usage.faces + usage.lines + usage.output + usage.indices + usage.interleaved + usage.levelsOfDetail + usage.bvh + usage.editing + usage.other;
+	return usage;
+}
+
+bool Objex::hasSourceData() const
+{
+	return mHasSourceData;
+}
+
+void Objex::generateNormals()
+{
+	generateNormals(NormalOptions());
+}
+
+void Objex::generateNormals(const NormalOptions& options)
+{
+	if (!mHasSourceData)
+	{
+		std::cerr << "Normals cannot be generated without source data." << std::endl;
+		return;
+	}
+
+	// indexed output may have a different number of vertices with the new normals
+	const std::size_t previousNumberOfVertices{ mVertexArray.size() };
+	generateNormalData(options);
+	refreshData();
+	if (mVertexArray.size() != previousNumberOfVertices)
+		createColorArray();
+}
+
+bool Objex::createLevelsOfDetail(const std::vector<LevelOfDetailTarget>& targets)
+{
+	mLevelsOfDetail.clear();
+	if (!mOutputOptions.indexed)
+	{
+		std::cerr << "Levels of detail require indexed output." << std::endl;
+		return false;
+	}
+	if (!mHasSourceData)
+	{
+		std::cerr << "Levels of detail require source data." << std::endl;
+		return false;
+	}
+
+	// each output vertex (wedge) belongs to the surface vertex of its position. wedges without a valid position are their own vertex
+	const std::size_t numberOfWedges{ getNumberOfVertices() };
+	std::vector<unsigned int> wedgeVertices(numberOfWedges);
+	for (std::size_t wedge{ 0u }; wedge < numberOfWedges; ++wedge)
+	{
+		const int position{ mFaceVertexIndices[mIndexedVertexCorners[wedge]] };
+		wedgeVertices[wedge] = ((position >= 0) && (position < static_cast<int>(mVertices.size()))) ? static_cast<unsigned int>(position) : static_cast<unsigned int>(mVertices.size() + wedge);
+	}
+	std::vector<GLuint> indices(mShortIndexArray.begin(), mShortIndexArray.end());
+	indices.insert(indices.end(), mIndexArray.begin(), mIndexArray.end());
+	std::vector<int> triangleMaterials;
+	triangleMaterials.reserve(indices.size() / 3);
+	for (const auto& submesh : mSubmeshes)
+		triangleMaterials.insert(triangleMaterials.end(), submesh.count / 3, submesh.material);
+
+	// one simplification continues through all of the targets (in order) and each level is a snapshot of it
+	MeshSimplifier simplifier(mVertexArray.data(), wedgeVertices, mVertices.size() + numberOfWedges, std::move(indices), std::move(triangleMaterials));
+	for (const auto& target : targets)
+	{
+		LevelOfDetailData level;
+		level.error = simplifier.simplify(target.numberOfTriangles, target.maximumError);
+		simplifier.getTriangles(level.indices, triangleMaterials);
+		for (std::size_t triangle{ 0u }; triangle < triangleMaterials.size(); ++triangle)
+		{
+			if (level.submeshes.empty() || (level.submeshes.back().material != triangleMaterials[triangle]))
+				level.submeshes.push_back({ triangleMaterials[triangle], static_cast<unsigned int>(triangle * 3), 0u, Box() });
+			level.submeshes.back().count += 3u;
+		}
+		if (mIndexArray.empty())
+		{
+			level.shortIndices.assign(level.indices.begin(), level.indices.end());
+			level.indices = std::vector<GLuint>();
+		}
+		if (mLoadOptions.logInformation)
+			std::clog << "Level of detail " << mLevelsOfDetail.size() << ": " << triangleMaterials.size() << " triangles (error " << level.error << ")" << std::endl;
+		mLevelsOfDetail.push_back(std::move(level));
+	}
+	refreshSubmeshBounds();
+	return true;
+}
+
+unsigned int Objex::getNumberOfLevelsOfDetail() const
+{
+	return static_cast<unsigned int>(mLevelsOfDetail.size());
+}
+
+Objex::LevelOfDetail Objex::getLevelOfDetail(const unsigned int level) const
+{
+	const LevelOfDetailData& data(mLevelsOfDetail[level]);
+	const GLvoid* const indexData{ data.shortIndices.empty() ? static_cast<const GLvoid*>(data.indices.data()) : static_cast<const GLvoid*>(data.shortIndices.data()) };
+	return{ indexData, static_cast<unsigned int>(data.shortIndices.size() + data.indices.size()), data.error, ArrayView<Submesh>(data.submeshes.data(), data.submeshes.size()) };
+}
+
+void Objex::scale(float scale)
+{
+	const float matrix[16]{ scale, 0.f, 0.f, 0.f, 0.f, scale, 0.f, 0.f, 0.f, 0.f, scale, 0.f, 0.f, 0.f, 0.f, 1.f };
+	transformPositions(matrix, true);
+}
+
+void Objex::translate(const Vertex& offset, const bool refreshOutput)
+{
+	const float matrix[16]{ 1.f, 0.f, 0.f, 0.f, 0.f, 1.f, 0.f, 0.f, 0.f, 0.f, 1.f, 0.f, offset.x, offset.y, offset.z, 1.f };
+	transformPositions(matrix, refreshOutput);
+}
+
+void Objex::rotate(const float angle, const Vertex& axis, const bool refreshOutput)
+{
+	const float axisLength{ std::sqrt(axis.x * axis.x + axis.y * axis.y + axis.z * axis.z) };
+	if (axisLength == 0.f)
+		return;
+	const float x{ axis.x / axisLength }, y{ axis.y / axisLength }, z{ axis.z / axisLength };
+	const float radians{ angle * 3.14159265358979f / 180.f };
+	const float c{ std::cos(radians) };
+	const float s{ std::sin(radians) };
+	const float t{ 1.f - c };
+
+	// rotation is orthonormal so it is also the normal matrix
+	const float rotation[9]{ t * x * x + c, t * x * y + s * z, t * x * z - s * y,
+		t * x * y - s * z, t * y * y + c, t * y * z + s * x,
+		t * x * z + s * y, t * y * z - s * x, t * z * z + c };
+	const float matrix[16]{ rotation[0], rotation[1], rotation[2], 0.f, rotation[3], rotation[4], rotation[5], 0.f, rotation[6], rotation[7], rotation[8], 0.f, 0.f, 0.f, 0.f, 1.f };
+	transformPositions(matrix, refreshOutput);
+	transformNormals(rotation, false, refreshOutput);
+}
+
+void Objex::applyMatrix(const float matrix[16], const bool refreshOutput)
+{
+	transformPositions(matrix, refreshOutput);
+
+	// normal matrix is the inverse transpose of the upper 3x3 (the cofactor matrix divided by the determinant). the result is normalized so the division is not needed
+	const float a{ matrix[0] }, b{ matrix[4] }, c{ matrix[8] };
+	const float d{ matrix[1] }, e{ matrix[5] }, f{ matrix[9] };
+	const float g{ matrix[2] }, h{ matrix[6] }, i{ matrix[10] };
+	float normalMatrix[9]{ e * i - f * h, f * g - d * i, d * h - e * g,
+		c * h - b * i, a * i - c * g, b * g - a * h,
+		b * f - c * e, c * d - a * f, a * e - b * d };
+	const float determinant{ a * normalMatrix[0] + b * normalMatrix[1] + c * normalMatrix[2] };
+	if (determinant < 0.f) // keep normals pointing outwards when the matrix mirrors
+	{
+		for (auto& element : normalMatrix)
+			element = -element;
+	}
+	transformNormals(normalMatrix, true, refreshOutput);
+}
+
+void Objex::applyNormalMatrix(const float matrix[9], const bool refreshOutput)
+{
+	transformNormals(matrix, false, refreshOutput);
+}
+
+void Objex::setVertex(unsigned int vertexNumber, Vertex& vertexData)
+{
+	changeVertex(vertexNumber, vertexData);
+}
+
+void Objex::setVertexNormal(unsigned int vertexNormalNumber, Vertex& vertexNormalData)
+{
+	mNormals[vertexNormalNumber] = vertexNormalData;
+	mChangedNormals.push_back(vertexNormalNumber);
+}
+
+void Objex::setTextureVertex(unsigned int textureVertexNumber, Vertex& textureVertexData)
+{
+	mTextures[textureVertexNumber] = textureVertexData;
+	mChangedTextures.push_back(textureVertexNumber);
+}
+
+void Objex::setFace(unsigned int faceNumber, Face& faceData)
+{
+	storeFace(faceNumber, faceData);
+	mAreFacesChanged = true;
+}
+
+void Objex::setVertices(unsigned int firstVertexNumber, const Vertex* vertices, std::size_t numberOfVertices)
+{
+	for (std::size_t i{ 0u }; i < numberOfVertices; ++i)
+		changeVertex(firstVertexNumber + i, vertices[i]);
+}
+
+void Objex::setVertexNormals(unsigned int firstVertexNormalNumber, const Vertex* vertexNormals, std::size_t numberOfVertexNormals)
+{
+	std::copy(vertexNormals, vertexNormals + numberOfVertexNormals, mNormals.begin() + firstVertexNormalNumber);
+	for (std::size_t i{ 0u }; i < numberOfVertexNormals; ++i)
+		mChangedNormals.push_back(firstVertexNormalNumber + i);
+}
+
+void Objex::setTextureVertices(unsigned int firstTextureVertexNumber, const Vertex* textureVertices, std::size_t numberOfTextureVertices)
+{
+	std::copy(textureVertices, textureVertices + numberOfTextureVertices, mTextures.begin() + firstTextureVertexNumber);
+	for (std::size_t i{ 0u }; i < numberOfTextureVertices; ++i)
+		mChangedTextures.push_back(firstTextureVertexNumber + i);
+}
+
+void Objex::setFaces(unsigned int firstFaceNumber, const Face* faces, std::size_t numberOfFaces)
+{
+	for (std::size_t i{ 0u }; i < numberOfFaces; ++i)
+		storeFace(firstFaceNumber + i, faces[i]);
+	if (numberOfFaces > 0u)
+		mAreFacesChanged = true;
+}
+
+void Objex::beginEdit()
+{
+	mIsEditing = true;
+}
+
+Objex::ChangedRanges Objex::commitEdit()
+{
+	mIsEditing = false;
+	const ChangedRanges changedRanges{ refreshChangedData() };
+	if (mIsLocalBoundingBoxOutdated)
+		refreshLocalBoundingBox();
+	return changedRanges;
+}
+
+Objex::Vertex Objex::getVertex(unsigned int vertexNumber)
+{
+	return mVertices[vertexNumber];
+}
+
+Objex::Vertex Objex::getVertexNormal(unsigned int vertexNormalNumber)
+{
+	return mNormals[vertexNormalNumber];
+}
+
+Objex::Vertex Objex::getTextureVertex(unsigned int textureVertexNumber)
+{
+	return mTextures[textureVertexNumber];
+}
+
+Objex::Face Objex::getFace(unsigned int faceNumber)
+{
+	const FaceView faceView{ viewFace(faceNumber) };
+	Face face;
+	face.vertexIndices.assign(faceView.vertexIndices.begin(), faceView.vertexIndices.end());
+	face.normalIndices.assign(faceView.normalIndices.begin(), faceView.normalIndices.end());
+	face.textureIndices.assign(faceView.textureIndices.begin(), faceView.textureIndices.end());
+	return face;
+}
+
+std::vector<Objex::Vertex> Objex::getAllVertices()
+{
+	return mVertices;
+}
+
+std::vector<Objex::Vertex> Objex::getAllVertexNormals()
+{
+	return mNormals;
+}
+
+std::vector<Objex::Vertex> Objex::getAllTextureVertices()
+{
+	return mTextures;
+}
+
+std::vector<Objex::Face> Objex::getAllFaces()
+{
+	std::vector<Face> faces;
+	faces.reserve(getNumberOfFaces());
+	for (unsigned int face{ 0u }; face < getNumberOfFaces(); ++face)
+		faces.push_back(getFace(face));
+	return faces;
+}
+
+const Objex::Vertex& Objex::viewVertex(unsigned int vertexNumber) const
+{
+	return mVertices[vertexNumber];
+}
+
+const Objex::Vertex& Objex::viewVertexNormal(unsigned int vertexNormalNumber) const
+{
+	return mNormals[vertexNormalNumber];
+}
+
+const Objex::Vertex& Objex::viewTextureVertex(unsigned int textureVertexNumber) const
+{
+	return mTextures[textureVertexNumber];
+}
+
+Objex::FaceView Objex::viewFace(unsigned int faceNumber) const
+{
+	const unsigned int firstCorner{ mFaceFirstCorners[faceNumber] };
+	const std::size_t numberOfCorners{ mFaceFirstCorners[faceNumber + 1] - firstCorner };
+	return{ { mFaceVertexIndices.data() + firstCorner, numberOfCorners }, { mFaceNormalIndices.data() + firstCorner, numberOfCorners }, { mFaceTextureIndices.data() + firstCorner, numberOfCorners } };
+}
+
+Objex::ArrayView<Objex::Vertex> Objex::viewAllVertices() const
+{
+	return{ mVertices.data(), mVertices.size() };
+}
+
+Objex::ArrayView<Objex::Vertex> Objex::viewAllVertexNormals() const
+{
+	return{ mNormals.data(), mNormals.size() };
+}
+
+Objex::ArrayView<Objex::Vertex> Objex::viewAllTextureVertices() const
+{
+	return{ mTextures.data(), mTextures.size() };
+}
+
+unsigned int Objex::getNumberOfFaces() const
+{
+	return static_cast<unsigned int>(mFaceFirstCorners.size() - 1);
+}
+
+Objex::ArrayView<Objex::Material> Objex::viewMaterials() const
+{
+	return{ mMaterials.data(), mMaterials.size() };
+}
+
+Objex::ArrayView<std::string> Objex::viewGroupNames() const
+{
+	return{ mGroupNames.data(), mGroupNames.size() };
+}
+
+Objex::ArrayView<std::string> Objex::viewObjectNames() const
+{
+	return{ mObjectNames.data(), mObjectNames.size() };
+}
+
+Objex::ArrayView<std::string> Objex::viewMaterialLibraries() const
+{
+	return{ mMaterialLibraries.data(), mMaterialLibraries.size() };
+}
+
+int Objex::getFaceMaterial(unsigned int faceNumber) const
+{
+	return mFaceMaterials[faceNumber];
+}
+
+int Objex::getFaceGroup(unsigned int faceNumber) const
+{
+	return mFaceGroups[faceNumber];
+}
+
+int Objex::getFaceObject(unsigned int faceNumber) const
+{
+	return mFaceObjects[faceNumber];
+}
+
+Objex::ArrayView<Objex::Submesh> Objex::viewSubmeshes() const
+{
+	return{ mSubmeshes.data(), mSubmeshes.size() };
+}
+
+Objex::ArrayView<Objex::Cluster> Objex::viewClusters() const
+{
+	return{ mClusters.data(), mClusters.size() };
+}
+
+void Objex::buildBvh()
+{
+	buildBvh(BvhOptions());
+}
+
+void Objex::buildBvh(const BvhOptions& options)
+{
+	mBvhOptions = options;
+	mBvhNodes.clear();
+	mBvhTriangles.clear();
+	if (!mHasSourceData)
+	{
+		std::cerr << "A bvh requires source data." << std::endl;
+		return;
+	}
+
+	// every triangle of every face (as they are output) that has valid vertices
+	const int numberOfVertices{ static_cast<int>(mVertices.size()) };
+	for (unsigned int face{ 0u }; face < getNumberOfFaces(); ++face)
+	{
+		const unsigned int firstCorner{ mFaceFirstCorners[face] };
+		const unsigned int numberOfCorners{ mFaceFirstCorners[face + 1] - firstCorner };
+		for (unsigned int triangle{ 0u }; triangle + 2 < numberOfCorners; ++triangle)
+		{
+			const BvhTriangle bvhTriangle{ { mFaceVertexIndices[firstCorner], mFaceVertexIndices[firstCorner + triangle + 1], mFaceVertexIndices[firstCorner + triangle + 2] }, face };
+			if (std::all_of(bvhTriangle.vertices, bvhTriangle.vertices + 3, [&](const int vertex) { return (vertex >= 0) && (vertex < numberOfVertices); }))
+				mBvhTriangles.push_back(bvhTriangle);
+		}
+	}
+	if (mBvhTriangles.empty())
+		return;
+
+	// bounds (minimum then maximum) of each triangle
+	const std::size_t numberOfTriangles{ mBvhTriangles.size() };
+	const unsigned int numberOfThreads{ getNumberOfThreads(options.numberOfThreads) };
+	std::vector<float> triangleBounds(numberOfTriangles * 6);
+	const std::size_t numberOfBoundsTasks{ std::max<std::size_t>(std::min<std::size_t>(numberOfThreads * 4u, numberOfTriangles / minimumFacesPerTask), 1u) };
+	runInParallel(numberOfBoundsTasks, numberOfThreads, [&](const std::size_t task)
+	{
+		for (std::size_t triangle{ numberOfTriangles * task / numberOfBoundsTasks }; triangle < numberOfTriangles * (task + 1) / numberOfBoundsTasks; ++triangle)
+		{
+			float* const bounds{ triangleBounds.data() + triangle * 6 };
+			const Vertex& first(mVertices[mBvhTriangles[triangle].vertices[0]]);
+			bounds[0] = bounds[3] = first.x;
+			bounds[1] = bounds[4] = first.y;
+			bounds[2] = bounds[5] = first.z;
+			for (unsigned int corner{ 1u }; corner < 3u; ++corner)
+			{
+				const Vertex& vertex(mVertices[mBvhTriangles[triangle].vertices[corner]]);
+				const float position[3]{ vertex.x, vertex.y, vertex.z };
+				includeInBounds(position, position, bounds, bounds + 3);
+			}
+		}
+	});
+
+	// the top of the tree is split on this thread until there are enough subtrees to build in parallel. each is built into its own nodes and they are then joined in depth-first order
+	std::vector<unsigned int> order(numberOfTriangles);
+	for (unsigned int triangle{ 0u }; triangle < numberOfTriangles; ++triangle)
+		order[triangle] = triangle;
+	unsigned int taskDepth{ 0u };
+	while ((numberOfThreads > 1u) && ((1u << taskDepth) < numberOfThreads * 4u))
+		++taskDepth;
+	if (numberOfThreads == 1u)
+		taskDepth = std::numeric_limits<unsigned int>::max();
+	std::vector<BvhNode> topNodes;
+	std::vector<unsigned int> taskNodes;
+	buildBvhNode(topNodes, order, 0u, static_cast<unsigned int>(numberOfTriangles), triangleBounds, 0u, taskDepth, taskNodes);
+	std::vector<std::vector<BvhNode>> subtrees(taskNodes.size());
+	runInParallel(taskNodes.size(), numberOfThreads, [&](const std::size_t task)
+	{
+		std::vector<unsigned int> noTaskNodes;
+		const BvhNode& taskNode(topNodes[taskNodes[task]]);
+		buildBvhNode(subtrees[task], order, taskNode.secondChildOrFirstTriangle, taskNode.numberOfTriangles, triangleBounds, 0u, std::numeric_limits<unsigned int>::max(), noTaskNodes);
+	});
+	std::vector<unsigned int> newTopNodes(topNodes.size());
+	std::size_t nextTask{ 0u };
+	for (std::size_t node{ 0u }; node < topNodes.size(); ++node)
+	{
+		newTopNodes[node] = static_cast<unsigned int>(mBvhNodes.size());
+		if ((nextTask < taskNodes.size()) && (taskNodes[nextTask] == node))
+		{
+			const unsigned int offset{ static_cast<unsigned int>(mBvhNodes.size()) };
+			for (auto subtreeNode : subtrees[nextTask++])
+			{
+				if (subtreeNode.numberOfTriangles == 0u)
+					subtreeNode.secondChildOrFirstTriangle += offset;
+				mBvhNodes.push_back(subtreeNode);
+			}
+		}
+		else
+			mBvhNodes.push_back(topNodes[node]);
+	}
+	for (std::size_t node{ 0u }; node < topNodes.size(); ++node)
+	{
+		if (topNodes[node].numberOfTriangles == 0u)
+			mBvhNodes[newTopNodes[node]].secondChildOrFirstTriangle = newTopNodes[topNodes[node].secondChildOrFirstTriangle];
+	}
+
+	std::vector<BvhTriangle> orderedTriangles(numberOfTriangles);
+	for (std::size_t triangle{ 0u }; triangle < numberOfTriangles; ++triangle)
+		orderedTriangles[triangle] = mBvhTriangles[order[triangle]];
+	mBvhTriangles.swap(orderedTriangles);
+	if (mLoadOptions.logInformation)
+		std::clog << "BVH: " << mBvhNodes.size() << " nodes for " << numberOfTriangles << " triangles" << std::endl;
+}
+
+void Objex::refitBvh()
+{
+	// children are always after their parent so they are refitted first
+	for (std::size_t node{ mBvhNodes.size() }; node-- > 0u;)
+	{
+		BvhNode& current(mBvhNodes[node]);
+		if (current.numberOfTriangles == 0u)
+		{
+			const BvhNode& firstChild(mBvhNodes[node + 1]);
+			const BvhNode& secondChild(mBvhNodes[current.secondChildOrFirstTriangle]);
+			for (unsigned int axis{ 0u }; axis < 3u; ++axis)
+			{
+				current.minimum[axis] = std::min(firstChild.minimum[axis], secondChild.minimum[axis]);
+				current.maximum[axis] = std::max(firstChild.maximum[axis], secondChild.maximum[axis]);
+			}
+			continue;
+		}
+		const Vertex& first(mVertices[mBvhTriangles[current.secondChildOrFirstTriangle].vertices[0]]);
+		const float firstPosition[3]{ first.x, first.y, first.z };
+		std::copy(firstPosition, firstPosition + 3, current.minimum);
+		std::copy(firstPosition, firstPosition + 3, current.maximum);
+		for (unsigned int triangle{ current.secondChildOrFirstTriangle }; triangle < current.secondChildOrFirstTriangle + current.numberOfTriangles; ++triangle)
+		{
+			for (const auto& vertexNumber : mBvhTriangles[triangle].vertices)
+			{
+				const Vertex& vertex(mVertices[vertexNumber]);
+				const float position[3]{ vertex.x, vertex.y, vertex.z };
+				includeInBounds(position, position, current.minimum, current.maximum);
+			}
+		}
+	}
+}
+
+bool Objex::hasBvh() const
+{
+	return !mBvhNodes.empty();
+}
+
+bool Objex::castRay(const Vertex& origin, const Vertex& direction, RayHit& hit, const float maximumDistance) const
 {
-	mVertexArray.resize(0);
-	mNormalArray.resize(0);
-	mTextureArray.resize(0);
-	for (const auto& face : mFaces)
+	if (mBvhNodes.empty())
+		return false;
+	const float rayOrigin[3]{ origin.x, origin.y, origin.z };
+	const float rayDirection[3]{ direction.x, direction.y, direction.z };
+	const float inverseDirection[3]{ 1.f / rayDirection[0], 1.f / rayDirection[1], 1.f / rayDirection[2] };
+	float closest{ maximumDistance };
+	bool isHit{ false };
+
+	// the nearer child is visited first so that more of the farther one can be skipped
+	std::vector<unsigned int> stack{ 0u };
+	while (!stack.empty())
+	{
+		const BvhNode& node(mBvhNodes[stack.back()]);
+		const unsigned int nodeNumber{ stack.back() };
+		stack.pop_back();
+		if (getRayBoxDistance(rayOrigin, inverseDirection, node.minimum, node.maximum, closest) > closest)
+			continue;
+		if (node.numberOfTriangles > 0u)
+		{
+			for (unsigned int triangle{ node.secondChildOrFirstTriangle }; triangle < node.secondChildOrFirstTriangle + node.numberOfTriangles; ++triangle)
+			{
+				const BvhTriangle& bvhTriangle(mBvhTriangles[triangle]);
+				float distance;
+				if (intersectRayTriangle(rayOrigin, rayDirection, mVertices[bvhTriangle.vertices[0]], mVertices[bvhTriangle.vertices[1]], mVertices[bvhTriangle.vertices[2]], closest, distance) &&
+					(!isHit || (distance < closest) || ((distance == closest) && (bvhTriangle.face < hit.face))))
+				{
+					closest = distance;
+					hit.face = bvhTriangle.face;
+					isHit = true;
+				}
+			}
+			continue;
+		}
+		const unsigned int children[2]{ nodeNumber + 1, node.secondChildOrFirstTriangle };
+		const float distances[2]{ getRayBoxDistance(rayOrigin, inverseDirection, mBvhNodes[children[0]].minimum, mBvhNodes[children[0]].maximum, closest), getRayBoxDistance(rayOrigin, inverseDirection, mBvhNodes[children[1]].minimum, mBvhNodes[children[1]].maximum, closest) };
+		const unsigned int nearer{ (distances[1] < distances[0]) ? 1u : 0u };
+		if (distances[1 - nearer] <= closest)
+			stack.push_back(children[1 - nearer]);
+		if (distances[nearer] <= closest)
+			stack.push_back(children[nearer]);
+	}
+	if (isHit)
+	{
+		hit.distance = closest;
+		hit.point = { origin.x + direction.x * closest, origin.y + direction.y * closest, origin.z + direction.z * closest };
+	}
+	return isHit;
+}
+
+bool Objex::isRayBlocked(const Vertex& origin, const Vertex& direction, const float maximumDistance) const
+{
+	if (mBvhNodes.empty())
+		return false;
+	const float rayOrigin[3]{ origin.x, origin.y, origin.z };
+	const float rayDirection[3]{ direction.x, direction.y, direction.z };
+	const float inverseDirection[3]{ 1.f / rayDirection[0], 1.f / rayDirection[1], 1.f / rayDirection[2] };
+	std::vector<unsigned int> stack{ 0u };
+	while (!stack.empty())
+	{
+		const unsigned int nodeNumber{ stack.back() };
+		const BvhNode& node(mBvhNodes[nodeNumber]);
+		stack.pop_back();
+		if (getRayBoxDistance(rayOrigin, inverseDirection, node.minimum, node.maximum, maximumDistance) > maximumDistance)
+			continue;
+		if (node.numberOfTriangles == 0u)
+		{
+			stack.push_back(node.secondChildOrFirstTriangle);
+			stack.push_back(nodeNumber + 1);
+			continue;
+		}
+		for (unsigned int triangle{ node.secondChildOrFirstTriangle }; triangle < node.secondChildOrFirstTriangle + node.numberOfTriangles; ++triangle)
+		{
+			const BvhTriangle& bvhTriangle(mBvhTriangles[triangle]);
+			float distance;
+			if (intersectRayTriangle(rayOrigin, rayDirection, mVertices[bvhTriangle.vertices[0]], mVertices[bvhTriangle.vertices[1]], mVertices[bvhTriangle.vertices[2]], maximumDistance, distance))
+				return true;
+		}
+	}
+	return false;
+}
+
+std::vector<unsigned int> Objex::findFacesInBox(const Box& box) const
+{
+	std::vector<unsigned int> faces;
+	if (mBvhNodes.empty())
+		return faces;
+	const float minimum[3]{ std::min(box.left, box.right), std::min(box.bottom, box.top), std::min(box.back, box.front) };
+	const float maximum[3]{ std::max(box.left, box.right), std::max(box.bottom, box.top), std::max(box.back, box.front) };
+	const float centre[3]{ (minimum[0] + maximum[0]) / 2.f, (minimum[1] + maximum[1]) / 2.f, (minimum[2] + maximum[2]) / 2.f };
+	const float halfSize[3]{ (maximum[0] - minimum[0]) / 2.f, (maximum[1] - minimum[1]) / 2.f, (maximum[2] - minimum[2]) / 2.f };
+	std::vector<unsigned int> stack{ 0u };
+	while (!stack.empty())
 	{
-		transferFaceToArray(face.vertexIndices, mVertices, mVertexArray);
-		transferFaceToArray(face.normalIndices, mNormals, mNormalArray, Vertex{ 0, 0, 1 });
-		transferFaceToArray(face.textureIndices, mTextures, mTextureArray);
+		const unsigned int nodeNumber{ stack.back() };
+		const BvhNode& node(mBvhNodes[nodeNumber]);
+		stack.pop_back();
+		if ((node.minimum[0] > maximum[0]) || (node.maximum[0] < minimum[0]) || (node.minimum[1] > maximum[1]) || (node.maximum[1] < minimum[1]) || (node.minimum[2] > maximum[2]) || (node.maximum[2] < minimum[2]))
+			continue;
+		if (node.numberOfTriangles == 0u)
+		{
+			stack.push_back(node.secondChildOrFirstTriangle);
+			stack.push_back(nodeNumber + 1);
+			continue;
+		}
+		for (unsigned int triangle{ node.secondChildOrFirstTriangle }; triangle < node.secondChildOrFirstTriangle + node.numberOfTriangles; ++triangle)
+		{
+			const BvhTriangle& bvhTriangle(mBvhTriangles[triangle]);
+			if (doesTriangleOverlapBox(mVertices[bvhTriangle.vertices[0]], mVertices[bvhTriangle.vertices[1]], mVertices[bvhTriangle.vertices[2]], centre, halfSize))
+				faces.push_back(bvhTriangle.face);
+		}
 	}
-	vertexData = &mVertexArray.front();
-	normalData = &mNormalArray.front();
-	textureData = &mTextureArray.front();
+	std::sort(faces.begin(), faces.end());
+	faces.erase(std::unique(faces.begin(), faces.end()), faces.end());
+	return faces;
+}
+
+bool Objex::findNearestPoint(const Vertex& point, NearestPoint& nearest, const float maximumDistance) const
+{
+	if (mBvhNodes.empty())
+		return false;
+	const float position[3]{ point.x, point.y, point.z };
+	auto getBoxDistanceSquared = [&](const BvhNode& node)
+	{
+		float distanceSquared{ 0.f };
+		for (unsigned int axis{ 0u }; axis < 3u; ++axis)
+		{
+			const float outside{ std::max(std::max(node.minimum[axis] - position[axis], position[axis] - node.maximum[axis]), 0.f) };
+			distanceSquared += outside * outside;
+		}
+		return distanceSquared;
+	};
+	float closestSquared{ (maximumDistance < std::sqrt(std::numeric_limits<float>::max())) ? maximumDistance * maximumDistance : std::numeric_limits<float>::max() };
+	bool isFound{ false };
 
-	refreshLocalBoundingBox();
+	// the nearer child is visited first so that more of the farther one can be skipped
+	std::vector<unsigned int> stack{ 0u };
+	while (!stack.empty())
+	{
+		const unsigned int nodeNumber{ stack.back() };
+		const BvhNode& node(mBvhNodes[nodeNumber]);
+		stack.pop_back();
+		if (getBoxDistanceSquared(node) > closestSquared)
+			continue;
+		if (node.numberOfTriangles > 0u)
+		{
+			for (unsigned int triangle{ node.secondChildOrFirstTriangle }; triangle < node.secondChildOrFirstTriangle + node.numberOfTriangles; ++triangle)
+			{
+				const BvhTriangle& bvhTriangle(mBvhTriangles[triangle]);
+				float closestPoint[3];
+				getClosestPointOnTriangle(position, mVertices[bvhTriangle.vertices[0]], mVertices[bvhTriangle.vertices[1]], mVertices[bvhTriangle.vertices[2]], closestPoint);
+				const float offset[3]{ closestPoint[0] - position[0], closestPoint[1] - position[1], closestPoint[2] - position[2] };
+				const float distanceSquared{ dot(offset, offset) };
+				if ((distanceSquared <= closestSquared) && (!isFound || (distanceSquared < closestSquared) || (bvhTriangle.face < nearest.face)))
+				{
+					closestSquared = distanceSquared;
+					nearest.face = bvhTriangle.face;
+					nearest.point = { closestPoint[0], closestPoint[1], closestPoint[2] };
+					isFound = true;
+				}
+			}
+			continue;
+		}
+		const unsigned int children[2]{ nodeNumber + 1, node.secondChildOrFirstTriangle };
+		const float distances[2]{ getBoxDistanceSquared(mBvhNodes[children[0]]), getBoxDistanceSquared(mBvhNodes[children[1]]) };
+		const unsigned int nearer{ (distances[1] < distances[0]) ? 1u : 0u };
+		stack.push_back(children[1 - nearer]);
+		stack.push_back(children[nearer]);
+	}
+	if (isFound)
+		nearest.distance = std::sqrt(closestSquared);
+	return isFound;
 }
 
-bool Objex::loadFromFile(const std::string& filename)
+void Objex::randomizeColorData()
+{
+	unsigned int colorElementNumber{ 0 };
+	for (auto& colorElement : mColorArray)
+	{
+		++colorElementNumber;
+		if (colorElementNumber < 4)
+			colorElement = static_cast<float>(rand() % 1000) / 1000;
+		else
+		{
+			colorElementNumber = 0;
+			colorElement = 1.f;
+		}
+	}
+	refreshInterleavedData();
+}
+
+std::vector<std::string> Objex::getCommentLines()
+{
+	return mCommentLines;
+}
+
+std::vector<std::string> Objex::getUnprocessedLines()
+{
+	return mUnprocessedLines;
+}
+
+Objex::ArrayView<std::string> Objex::viewCommentLines() const
+{
+	return{ mCommentLines.data(), mCommentLines.size() };
+}
+
+Objex::ArrayView<std::string> Objex::viewUnprocessedLines() const
+{
+	return{ mUnprocessedLines.data(), mUnprocessedLines.size() };
+}
+
+
+
+
+
+
+
+
+// PRIVATE
+
+void Objex::clear()
+{
+	mVertices.clear();
+	mNormals.clear();
+	mTextures.clear();
+	mFaceFirstCorners.assign(1u, 0u);
+	mFaceVertexIndices.clear();
+	mFaceNormalIndices.clear();
+	mFaceTextureIndices.clear();
+	mFaceMaterials.clear();
+	mFaceGroups.clear();
+	mFaceObjects.clear();
+	mMaterials.clear();
+	mGroupNames.clear();
+	mObjectNames.clear();
+	mMaterialLibraries.clear();
+	mFaceOrder.clear();
+	mSubmeshes.clear();
+	mClusterFirstFaces.clear();
+	mClusters.clear();
+	mLevelsOfDetail.clear();
+	mBvhNodes.clear();
+	mBvhTriangles.clear();
+	mCommentLines.clear();
+	mUnprocessedLines.clear();
+	mNumberOfParsedLines = 0u;
+	mHasSourceData = true;
+	clearChanges();
+}
+
+bool Objex::loadFromObjFile(const std::string& filename, const LoadOptions& options)
 {
+	Stopwatch stopwatch;
+	if (options.fileAccess == FileAccess::MemoryMapped)
+	{
+		MappedFile mappedFile;
+		if (mappedFile.open(filename))
+		{
+			if (options.logInformation)
+				std::clog << "Importing .obj (memory-mapped): " << filename << std::endl;
+			const double mapTime{ stopwatch.restart() };
+			const bool isLoaded{ parseMemory(mappedFile.getData(), mappedFile.getSize(), options) };
+			mLoadStats.readTime += mapTime;
+			return isLoaded;
+		}
+		// mapping is not available (or the file is empty) so read it in blocks instead
+	}
 
-	std::ifstream file(filename, std::ifstream::in);
+	std::ifstream file(filename, std::ifstream::in | std::ifstream::binary);
 	if (!file.is_open())
 		return false;
 
 	struct stat filestatus;
 	stat(filename.c_str(), &filestatus);
-	std::string fileLine;
-	float previousProgress{ 0.f };
+	const unsigned long long fileSize{ static_cast<unsigned long long>(filestatus.st_size) };
 
-	// cache file
-	std::vector<std::string> mRawImportLines; // all lines directly from the file (get deleted when parsed)
-	while (getline(file, fileLine))
+	if (options.logInformation)
+		std::clog << "Importing .obj: " << filename << std::endl;
+	clear();
+	mLoadOptions = options;
+	mLoadStats.bytes = fileSize;
+
+	// read in large blocks (one per thread). any partial line at the end of a block is moved to the front of the buffer and completed by the next block
+	std::vector<char> buffer(bufferedBlockSize * getNumberOfThreads(options.numberOfThreads));
+	std::size_t carriedOver{ 0u };
+	unsigned long long bytesRead{ 0u };
+	unsigned int previousProgress{ 0u };
+	ParseScratch scratch;
+	while (file)
 	{
-		mRawImportLines.push_back(fileLine);
+		if (carriedOver == buffer.size()) // a single line is longer than the buffer
+			buffer.resize(buffer.size() * 2);
+		stopwatch.restart();
+		file.read(buffer.data() + carriedOver, buffer.size() - carriedOver);
+		mLoadStats.readTime += stopwatch.restart();
+		const std::size_t blockSize{ static_cast<std::size_t>(file.gcount()) };
+		bytesRead += blockSize;
+		const char* const begin{ buffer.data() };
+		const char* end{ begin + carriedOver + blockSize };
+		const char* completeLinesEnd{ end };
+		if (file) // more to come so only parse up to the last newline
+		{
+			while ((completeLinesEnd != begin) && (*(completeLinesEnd - 1) != '\n'))
+				--completeLinesEnd;
+		}
+		if (!parseBlock(begin, completeLinesEnd, scratch))
+		{
+			std::cerr << "Importing failed!" << std::endl;
+			return false;
+		}
+		mLoadStats.parseTime += stopwatch.restart();
+		if (isCancelled(options))
+		{
+			if (options.logInformation)
+				std::clog << "Importing cancelled." << std::endl;
+			clear();
+			return false;
+		}
+		carriedOver = end - completeLinesEnd;
+		std::copy(completeLinesEnd, end, buffer.data());
 
-		// show percentage of progress. only updates if percentage has increased (whole numbers only)
-		float progress{ round(static_cast<float>(file.tellg()) * 100 / filestatus.st_size) };
-		if (progress > previousProgress)
-			std::clog << "Loading " << filename << " " << progress << "%" << std::endl;
-		previousProgress = progress;
+		if (options.progressCallback)
+			options.progressCallback({ bytesRead, fileSize, mNumberOfParsedLines });
+		if (options.logInformation)
+			logProgress("Loading " + filename, bytesRead, fileSize, previousProgress);
 	}
 	file.close();
+	recordPeakMemory(scratch.getMemoryUsage() + getAllocatedSize(buffer));
+
+	return finishLoad();
+}
+
+bool Objex::loadFromCacheFile(const std::string& cacheFilename, const unsigned long long sourceSize, const long long sourceModificationTime, const LoadOptions& options)
+{
+	Stopwatch stopwatch;
+	MappedFile mappedFile;
+	if (!mappedFile.open(cacheFilename) || (mappedFile.getSize() < sizeof(CacheHeader)))
+		return false;
+	CacheHeader header;
+	std::memcpy(&header, mappedFile.getData(), sizeof(CacheHeader));
+	if (!std::equal(cacheMagic, cacheMagic + 8, header.magic) || (header.version != cacheVersion) || (header.byteOrderMark != cacheByteOrderMark))
+		return false;
+	if ((header.sourceSize != sourceSize) || (header.sourceModificationTime != sourceModificationTime))
+	{
+		if (options.logInformation)
+			std::clog << "Cache is outdated: " << cacheFilename << std::endl;
+		return false;
+	}
+	// generated normals are stored in the cache so it can only be used if they would be generated the same way
+	if ((header.normalGeneration != getNormalGeneration(options)) || (options.generateMissingNormals && (header.creaseAngle != options.normalOptions.creaseAngle)))
+	{
+		if (options.logInformation)
+			std::clog << "Cache has different normals: " << cacheFilename << std::endl;
+		return false;
+	}
+	std::uint64_t expectedSize{ sizeof(CacheHeader) };
+	for (const auto& sectionSize : header.sectionSizes)
+	{
+		if (sectionSize > mappedFile.getSize())
+			return false;
+		expectedSize += sectionSize + getCachePadding(static_cast<std::size_t>(sectionSize));
+	}
+	if (expectedSize != mappedFile.getSize())
+		return false;
 
-	std::clog << "Importing .obj:" << std::endl;
-	if (!parse(mRawImportLines))
+	if (options.logInformation)
+		std::clog << "Importing cache: " << cacheFilename << std::endl;
+	clear();
+	std::vector<std::uint32_t> commentLineLengths;
+	std::vector<std::uint32_t> unprocessedLineLengths;
+	std::vector<char> commentLineText;
+	std::vector<char> unprocessedLineText;
+	std::vector<std::uint32_t> materialNameLengths;
+	std::vector<std::uint32_t> groupNameLengths;
+	std::vector<std::uint32_t> objectNameLengths;
+	std::vector<std::uint32_t> materialLibraryLengths;
+	std::vector<char> materialNameText;
+	std::vector<char> groupNameText;
+	std::vector<char> objectNameText;
+	std::vector<char> materialLibraryText;
+	std::vector<std::string> materialNames;
+	const char* cursor{ mappedFile.getData() + sizeof(CacheHeader) };
+	const std::uint64_t* sectionSize{ header.sectionSizes };
+	const bool isValid{ readCacheSection(cursor, *sectionSize++, mVertices) &&
+		readCacheSection(cursor, *sectionSize++, mNormals) &&
+		readCacheSection(cursor, *sectionSize++, mTextures) &&
+		readCacheSection(cursor, *sectionSize++, mFaceFirstCorners) &&
+		readCacheSection(cursor, *sectionSize++, mFaceVertexIndices) &&
+		readCacheSection(cursor, *sectionSize++, mFaceNormalIndices) &&
+		readCacheSection(cursor, *sectionSize++, mFaceTextureIndices) &&
+		readCacheSection(cursor, *sectionSize++, mFaceMaterials) &&
+		readCacheSection(cursor, *sectionSize++, mFaceGroups) &&
+		readCacheSection(cursor, *sectionSize++, mFaceObjects) &&
+		readCacheSection(cursor, *sectionSize++, mVertexArray) &&
+		readCacheSection(cursor, *sectionSize++, mNormalArray) &&
+		readCacheSection(cursor, *sectionSize++, mTextureArray) &&
+		readCacheSection(cursor, *sectionSize++, mShortIndexArray) &&
+		readCacheSection(cursor, *sectionSize++, mIndexArray) &&
+		readCacheSection(cursor, *sectionSize++, mIndexedVertexCorners) &&
+		readCacheSection(cursor, *sectionSize++, commentLineLengths) &&
+		readCacheSection(cursor, *sectionSize++, commentLineText) &&
+		readCacheSection(cursor, *sectionSize++, unprocessedLineLengths) &&
+		readCacheSection(cursor, *sectionSize++, unprocessedLineText) &&
+		readCacheSection(cursor, *sectionSize++, materialNameLengths) &&
+		readCacheSection(cursor, *sectionSize++, materialNameText) &&
+		readCacheSection(cursor, *sectionSize++, groupNameLengths) &&
+		readCacheSection(cursor, *sectionSize++, groupNameText) &&
+		readCacheSection(cursor, *sectionSize++, objectNameLengths) &&
+		readCacheSection(cursor, *sectionSize++, objectNameText) &&
+		readCacheSection(cursor, *sectionSize++, materialLibraryLengths) &&
+		readCacheSection(cursor, *sectionSize++, materialLibraryText) &&
+		joinCacheLines(commentLineLengths, commentLineText, mCommentLines) &&
+		joinCacheLines(unprocessedLineLengths, unprocessedLineText, mUnprocessedLines) &&
+		joinCacheLines(materialNameLengths, materialNameText, materialNames) &&
+		joinCacheLines(groupNameLengths, groupNameText, mGroupNames) &&
+		joinCacheLines(objectNameLengths, objectNameText, mObjectNames) &&
+		joinCacheLines(materialLibraryLengths, materialLibraryText, mMaterialLibraries) &&
+		!mFaceFirstCorners.empty() && (mFaceFirstCorners.front() == 0u) && (mFaceFirstCorners.back() == mFaceVertexIndices.size()) && std::is_sorted(mFaceFirstCorners.begin(), mFaceFirstCorners.end()) &&
+		(mFaceNormalIndices.size() == mFaceVertexIndices.size()) && (mFaceTextureIndices.size() == mFaceVertexIndices.size()) &&
+		(mFaceMaterials.size() == getNumberOfFaces()) && (mFaceGroups.size() == getNumberOfFaces()) && (mFaceObjects.size() == getNumberOfFaces()) &&
+		(findInvalidIndex(mFaceVertexIndices, mVertices.size(), false) == mFaceVertexIndices.size()) &&
+		(findInvalidIndex(mFaceNormalIndices, mNormals.size(), true) == mFaceNormalIndices.size()) &&
+		(findInvalidIndex(mFaceTextureIndices, mTextures.size(), true) == mFaceTextureIndices.size()) &&
+		areValidPositions(mFaceMaterials, materialNames.size()) && areValidPositions(mFaceGroups, mGroupNames.size()) && areValidPositions(mFaceObjects, mObjectNames.size()) &&
+		(mVertexArray.size() % 3u == 0u) && (mNormalArray.size() == mVertexArray.size()) && (mTextureArray.size() == mVertexArray.size()) && areValidOutputIndices(mShortIndexArray, mVertexArray.size() / 3u) && areValidOutputIndices(mIndexArray, mVertexArray.size() / 3u) };
+	if (!isValid)
 	{
-		std::cerr << "Importing failed!" << std::endl;
+		std::cerr << "Cache is invalid: " << cacheFilename << std::endl;
+		clear();
 		return false;
 	}
+	mNumberOfParsedLines = header.numberOfParsedLines;
+	mLoadStats.isFromCache = true;
+	mLoadStats.bytes = mappedFile.getSize();
+	mLoadStats.readTime += stopwatch.restart();
+	for (auto& name : materialNames) // the rest of each material is loaded from its library
+	{
+		mMaterials.emplace_back();
+		mMaterials.back().name = std::move(name);
+	}
+
+	// output is used as is unless it was created with different output options
+	if (((header.isIndexed != 0u) != mOutputOptions.indexed) || (header.optimizations != getOutputOptimizations(mOutputOptions)) || (mOutputOptions.indexed && (header.vertexCacheSize != mOutputOptions.vertexCacheSize)) ||
+		(header.clusterLimits[0] != (mOutputOptions.clusters ? mOutputOptions.maximumClusterVertices : 0u)) || (header.clusterLimits[1] != (mOutputOptions.clusters ? mOutputOptions.maximumClusterTriangles : 0u)) ||
+		(mIndexedVertexCorners.size() != (mOutputOptions.indexed ? mVertexArray.size() / 3 : 0u)) || !areValidCorners(mIndexedVertexCorners, mFaceVertexIndices.size()) ||
+		(getNumberOfTriangles() != countTriangles()))
+		refreshData();
 	else
 	{
-		std::clog << "Importing completed!" << std::endl;
-		return true;
+		vertexData = mVertexArray.data();
+		normalData = mNormalArray.data();
+		textureData = mTextureArray.data();
+		indexData = mShortIndexArray.empty() ? (mIndexArray.empty() ? nullptr : static_cast<GLvoid*>(mIndexArray.data())) : static_cast<GLvoid*>(mShortIndexArray.data());
+		mLocalBoundingBox = header.localBoundingBox;
+		mIsLocalBoundingBoxOutdated = false;
+		mUnoptimizedVertexCacheStatistics = header.unoptimizedVertexCacheStatistics;
+		refreshFaceOrder();
+		refreshSubmeshes();
+		refreshTangentData();
+		refreshInterleavedData();
 	}
-}
+	mLoadStats.outputTime += stopwatch.restart();
+	createColorArray();
+	mLoadStats.colorTime += stopwatch.restart();
+	recordLoadCounts();
+	recordPeakMemory(0u);
+	if (!options.keepSourceData)
+		releaseSourceData();
 
-Objex::Vertex Objex::getLocalBoundingBoxCenter()
-{
-	return{ mLocalBoundingBox.width / 2 + mLocalBoundingBox.left, mLocalBoundingBox.height / 2 + mLocalBoundingBox.bottom, mLocalBoundingBox.depth / 2 + mLocalBoundingBox.back };
+	if (options.logInformation)
+		std::clog << "Importing completed!" << std::endl;
+	return true;
 }
 
-Objex::Box Objex::getLocalBoundingBox()
+bool Objex::saveToCacheFile(const std::string& cacheFilename, const unsigned long long sourceSize, const long long sourceModificationTime)
 {
-	return mLocalBoundingBox;
-}
+	std::ofstream file(cacheFilename, std::ofstream::out | std::ofstream::binary | std::ofstream::trunc);
+	if (!file.is_open())
+		return false;
 
-unsigned int Objex::getNumberOfVertices()
-{
-	return mVertexArray.size() / 3;
+	std::vector<std::uint32_t> commentLineLengths;
+	std::vector<std::uint32_t> unprocessedLineLengths;
+	std::vector<char> commentLineText;
+	std::vector<char> unprocessedLineText;
+	splitCacheLines(mCommentLines, commentLineLengths, commentLineText);
+	splitCacheLines(mUnprocessedLines, unprocessedLineLengths, unprocessedLineText);
+	std::vector<std::string> materialNames;
+	for (const auto& material : mMaterials)
+		materialNames.push_back(material.name);
+	std::vector<std::uint32_t> materialNameLengths;
+	std::vector<std::uint32_t> groupNameLengths;
+	std::vector<std::uint32_t> objectNameLengths;
+	std::vector<std::uint32_t> materialLibraryLengths;
+	std::vector<char> materialNameText;
+	std::vector<char> groupNameText;
+	std::vector<char> objectNameText;
+	std::vector<char> materialLibraryText;
+	splitCacheLines(materialNames, materialNameLengths, materialNameText);
+	splitCacheLines(mGroupNames, groupNameLengths, groupNameText);
+	splitCacheLines(mObjectNames, objectNameLengths, objectNameText);
+	splitCacheLines(mMaterialLibraries, materialLibraryLengths, materialLibraryText);
+
+	CacheHeader header{};
+	std::copy(cacheMagic, cacheMagic + 8, header.magic);
+	header.version = cacheVersion;
+	header.byteOrderMark = cacheByteOrderMark;
+	header.sourceSize = sourceSize;
+	header.sourceModificationTime = sourceModificationTime;
+	header.sectionSizes[Vertices] = mVertices.size() * sizeof(Vertex);
+	header.sectionSizes[Normals] = mNormals.size() * sizeof(Vertex);
+	header.sectionSizes[Textures] = mTextures.size() * sizeof(Vertex);
+	header.sectionSizes[FaceFirstCorners] = mFaceFirstCorners.size() * sizeof(unsigned int);
+	header.sectionSizes[FaceVertexIndices] = mFaceVertexIndices.size() * sizeof(int);
+	header.sectionSizes[FaceNormalIndices] = mFaceNormalIndices.size() * sizeof(int);
+	header.sectionSizes[FaceTextureIndices] = mFaceTextureIndices.size() * sizeof(int);
+	header.sectionSizes[FaceMaterials] = mFaceMaterials.size() * sizeof(int);
+	header.sectionSizes[FaceGroups] = mFaceGroups.size() * sizeof(int);
+	header.sectionSizes[FaceObjects] = mFaceObjects.size() * sizeof(int);
+	header.sectionSizes[VertexArray] = mVertexArray.size() * sizeof(GLfloat);
+	header.sectionSizes[NormalArray] = mNormalArray.size() * sizeof(GLfloat);
+	header.sectionSizes[TextureArray] = mTextureArray.size() * sizeof(GLfloat);
+	header.sectionSizes[ShortIndexArray] = mShortIndexArray.size() * sizeof(GLushort);
+	header.sectionSizes[IndexArray] = mIndexArray.size() * sizeof(GLuint);
+	header.sectionSizes[IndexedVertexCorners] = mIndexedVertexCorners.size() * sizeof(unsigned int);
+	header.sectionSizes[CommentLineLengths] = commentLineLengths.size() * sizeof(std::uint32_t);
+	header.sectionSizes[CommentLineText] = commentLineText.size();
+	header.sectionSizes[UnprocessedLineLengths] = unprocessedLineLengths.size() * sizeof(std::uint32_t);
+	header.sectionSizes[UnprocessedLineText] = unprocessedLineText.size();
+	header.sectionSizes[MaterialNameLengths] = materialNameLengths.size() * sizeof(std::uint32_t);
+	header.sectionSizes[MaterialNameText] = materialNameText.size();
+	header.sectionSizes[GroupNameLengths] = groupNameLengths.size() * sizeof(std::uint32_t);
+	header.sectionSizes[GroupNameText] = groupNameText.size();
+	header.sectionSizes[ObjectNameLengths] = objectNameLengths.size() * sizeof(std::uint32_t);
+	header.sectionSizes[ObjectNameText] = objectNameText.size();
+	header.sectionSizes[MaterialLibraryLengths] = materialLibraryLengths.size() * sizeof(std::uint32_t);
+	header.sectionSizes[MaterialLibraryText] = materialLibraryText.size();
+	header.isIndexed = mOutputOptions.indexed ? 1u : 0u;
+	header.optimizations = getOutputOptimizations(mOutputOptions);
+	header.vertexCacheSize = mOutputOptions.vertexCacheSize;
+	header.unoptimizedVertexCacheStatistics = mUnoptimizedVertexCacheStatistics;
+	header.numberOfParsedLines = mNumberOfParsedLines;
+	header.normalGeneration = getNormalGeneration(mLoadOptions);
+	header.creaseAngle = mLoadOptions.generateMissingNormals ? mLoadOptions.normalOptions.creaseAngle : 0.f;
+	header.clusterLimits[0] = mOutputOptions.clusters ? mOutputOptions.maximumClusterVertices : 0u;
+	header.clusterLimits[1] = mOutputOptions.clusters ? mOutputOptions.maximumClusterTriangles : 0u;
+	header.localBoundingBox = getLocalBoundingBox();
+
+	file.write(reinterpret_cast<const char*>(&header), sizeof(CacheHeader));
+	writeCacheSection(file, mVertices);
+	writeCacheSection(file, mNormals);
+	writeCacheSection(file, mTextures);
+	writeCacheSection(file, mFaceFirstCorners);
+	writeCacheSection(file, mFaceVertexIndices);
+	writeCacheSection(file, mFaceNormalIndices);
+	writeCacheSection(file, mFaceTextureIndices);
+	writeCacheSection(file, mFaceMaterials);
+	writeCacheSection(file, mFaceGroups);
+	writeCacheSection(file, mFaceObjects);
+	writeCacheSection(file, mVertexArray);
+	writeCacheSection(file, mNormalArray);
+	writeCacheSection(file, mTextureArray);
+	writeCacheSection(file, mShortIndexArray);
+	writeCacheSection(file, mIndexArray);
+	writeCacheSection(file, mIndexedVertexCorners);
+	writeCacheSection(file, commentLineLengths);
+	writeCacheSection(file, commentLineText);
+	writeCacheSection(file, unprocessedLineLengths);
+	writeCacheSection(file, unprocessedLineText);
+	writeCacheSection(file, materialNameLengths);
+	writeCacheSection(file, materialNameText);
+	writeCacheSection(file, groupNameLengths);
+	writeCacheSection(file, groupNameText);
+	writeCacheSection(file, objectNameLengths);
+	writeCacheSection(file, objectNameText);
+	writeCacheSection(file, materialLibraryLengths);
+	writeCacheSection(file, materialLibraryText);
+	return static_cast<bool>(file);
 }
 
-unsigned int Objex::getNumberOfTriangles()
+bool Objex::parseBlock(const char* begin, const char* end, ParseScratch& scratch)
 {
-	return getNumberOfVertices() / 3;
+	// split the block into one chunk per thread at line boundaries
+	const unsigned int numberOfThreads{ getNumberOfThreads(mLoadOptions.numberOfThreads) };
+	std::vector<const char*>& chunkBoundaries(scratch.chunkBoundaries);
+	chunkBoundaries.assign(1u, begin);
+	for (unsigned int chunk{ 1u }; chunk < numberOfThreads; ++chunk)
+	{
+		const char* boundary{ begin + (end - begin) * chunk / numberOfThreads };
+		boundary = std::max(boundary, chunkBoundaries.back());
+		while ((boundary != end) && (boundary != begin) && (*(boundary - 1) != '\n'))
+			++boundary;
+		if (boundary - chunkBoundaries.back() >= static_cast<std::ptrdiff_t>(minimumChunkSize))
+			chunkBoundaries.push_back(boundary);
+	}
+	chunkBoundaries.push_back(end);
+
+	// parse chunks independently. each one resolves relative indices against its own counts
+	const std::size_t numberOfChunks{ chunkBoundaries.size() - 1 };
+	if (scratch.chunks.size() < numberOfChunks)
+		scratch.chunks.resize(numberOfChunks);
+	runInParallel(numberOfChunks, numberOfThreads, [&](const std::size_t chunk)
+	{
+		scratch.chunks[chunk].clear();
+		parseLines(chunkBoundaries[chunk], chunkBoundaries[chunk + 1], scratch.chunks[chunk]);
+	});
+
+	// merge chunks in order, fixing up the relative indices by the number of elements before each chunk (an exclusive prefix sum of the chunks' counts)
+	for (std::size_t chunkNumber{ 0u }; chunkNumber < numberOfChunks; ++chunkNumber)
+	{
+		ParsedChunk& chunk(scratch.chunks[chunkNumber]);
+		if (chunk.failedLine != 0u)
+		{
+			std::cerr << "Unable to parse line " << mNumberOfParsedLines + chunk.failedLine << ": " << chunk.failedLineText << std::endl;
+			return false;
+		}
+
+		const int vertexOffset{ static_cast<int>(mVertices.size()) };
+		const int normalOffset{ static_cast<int>(mNormals.size()) };
+		const int textureOffset{ static_cast<int>(mTextures.size()) };
+		for (const auto& relativeIndex : chunk.relativeIndices)
+		{
+			int* index;
+			switch (relativeIndex.type)
+			{
+			case RelativeIndex::Type::Vertex:
+				index = &chunk.faceVertexIndices[relativeIndex.corner];
+				*index += vertexOffset;
+				break;
+			case RelativeIndex::Type::Normal:
+				index = &chunk.faceNormalIndices[relativeIndex.corner];
+				*index += normalOffset;
+				break;
+			case RelativeIndex::Type::Texture:
+			default:
+				index = &chunk.faceTextureIndices[relativeIndex.corner];
+				*index += textureOffset;
+				break;
+			}
+			if (*index < 0)
+			{
+				std::cerr << "Relative index refers to before the start of the file (face " << getNumberOfFaces() + relativeIndex.face + 1u << ")" << std::endl;
+				return false;
+			}
+		}
+
+		// faces' first corners are also offset by the number of corners before the chunk
+		const unsigned int cornerOffset{ static_cast<unsigned int>(mFaceVertexIndices.size()) };
+		const std::size_t firstCornersCapacity{ mFaceFirstCorners.capacity() };
+		mFaceFirstCorners.pop_back();
+		for (const auto& firstCorner : chunk.faceFirstCorners)
+			mFaceFirstCorners.push_back(firstCorner + cornerOffset);
+		mFaceFirstCorners.push_back(cornerOffset + static_cast<unsigned int>(chunk.faceVertexIndices.size()));
+
+		const bool reallocated[]{ mFaceFirstCorners.capacity() != firstCornersCapacity,
+			appendMoved(mVertices, chunk.vertices),
+			appendMoved(mNormals, chunk.normals),
+			appendMoved(mTextures, chunk.textures),
+			appendMoved(mFaceVertexIndices, chunk.faceVertexIndices),
+			appendMoved(mFaceNormalIndices, chunk.faceNormalIndices),
+			appendMoved(mFaceTextureIndices, chunk.faceTextureIndices),
+			appendMoved(mCommentLines, chunk.commentLines),
+			appendMoved(mUnprocessedLines, chunk.unprocessedLines) };
+		mLoadStats.allocations += std::count(std::begin(reallocated), std::end(reallocated), true);
+
+		// faces before a chunk's first material/group/object continue the one from the end of the previous chunk
+		mergeFaceNames(chunk.materials, scratch.materials, mFaceMaterials, [&](std::string& name)
+		{
+			mMaterials.emplace_back();
+			mMaterials.back().name = std::move(name);
+		});
+		mergeFaceNames(chunk.groups, scratch.groups, mFaceGroups, [&](std::string& name) { mGroupNames.push_back(std::move(name)); });
+		mergeFaceNames(chunk.objects, scratch.objects, mFaceObjects, [&](std::string& name) { mObjectNames.push_back(std::move(name)); });
+		for (auto& materialLibrary : chunk.materialLibraries)
+		{
+			if (std::find(mMaterialLibraries.begin(), mMaterialLibraries.end(), materialLibrary) == mMaterialLibraries.end())
+				mMaterialLibraries.push_back(std::move(materialLibrary));
+		}
+		mNumberOfParsedLines += chunk.numberOfLines;
+	}
+	return true;
 }
 
-void Objex::scale(float scale)
+bool Objex::finishLoad()
 {
-	for (auto& vertex : mVertices)
+	if (isCancelled(mLoadOptions))
+	{
+		if (mLoadOptions.logInformation)
+			std::clog << "Importing cancelled." << std::endl;
+		clear();
+		return false;
+	}
+	if (mLoadOptions.logInformation)
+	{
+		std::clog << "Lines in file: " << mNumberOfParsedLines << std::endl;
+		std::clog << "Comment lines: " << mCommentLines.size() << std::endl;
+		std::clog << "Unprocessed lines: " << mUnprocessedLines.size() << std::endl;
+		std::clog << "Materials: " << mMaterials.size() << std::endl;
+	}
+
+	// indices are only checked against the number of elements once the whole file has been read (relative indices are checked as they are resolved)
+	const std::size_t invalidCorner{ std::min({ findInvalidIndex(mFaceVertexIndices, mVertices.size(), false),
+		findInvalidIndex(mFaceNormalIndices, mNormals.size(), true), findInvalidIndex(mFaceTextureIndices, mTextures.size(), true) }) };
+	if (invalidCorner != mFaceVertexIndices.size())
+	{
+		const std::size_t face{ static_cast<std::size_t>(std::upper_bound(mFaceFirstCorners.begin(), mFaceFirstCorners.end(), static_cast<unsigned int>(invalidCorner)) - mFaceFirstCorners.begin()) };
+		std::cerr << "Index refers to past the end of the file (face " << face << ")" << std::endl;
+		clear();
+		return false;
+	}
+
+	Stopwatch stopwatch;
+	if (mLoadOptions.generateMissingNormals && mNormals.empty() && (getNumberOfFaces() > 0u))
 	{
-		vertex.x *= scale;
-		vertex.y *= scale;
-		vertex.z *= scale;
+		generateNormalData(mLoadOptions.normalOptions);
+		mLoadStats.normalTime += stopwatch.restart();
+		if (mLoadOptions.logInformation)
+			std::clog << "Generated normals: " << mNormals.size() << std::endl;
 	}
+
+	// generate container to store all data in order required by OpenGL
 	refreshData();
-}
+	mLoadStats.outputTime += stopwatch.restart();
+	createColorArray();
+	mLoadStats.colorTime += stopwatch.restart();
+	recordLoadCounts();
+	recordPeakMemory(0u);
+	if (!mLoadOptions.keepSourceData)
+		releaseSourceData();
 
-void Objex::setVertex(unsigned int vertexNumber, Vertex& vertexData)
-{
-	mVertices[vertexNumber] = vertexData;
-	refreshLocalBoundingBox();
+	if (mLoadOptions.logInformation)
+		std::clog << "Importing completed!" << std::endl;
+	return true;
 }
 
-void Objex::setVertexNormal(unsigned int vertexNormalNumber, Vertex& vertexNormalData)
+void Objex::recordLoadCounts()
 {
-	mNormals[vertexNormalNumber] = vertexNormalData;
+	mLoadStats.lines = mNumberOfParsedLines;
+	mLoadStats.vertices = static_cast<unsigned int>(mVertices.size());
+	mLoadStats.normals = static_cast<unsigned int>(mNormals.size());
+	mLoadStats.textureVertices = static_cast<unsigned int>(mTextures.size());
+	mLoadStats.faces = getNumberOfFaces();
+	mLoadStats.triangles = getNumberOfTriangles();
+	mLoadStats.materials = static_cast<unsigned int>(mMaterials.size());
 }
 
-void Objex::setTextureVertex(unsigned int textureVertexNumber, Vertex& textureVertexData)
+// temporary memory is memory used by the load that is not (or no longer) part of the object
+void Objex::recordPeakMemory(const std::size_t temporaryMemory)
 {
-	mTextures[textureVertexNumber] = textureVertexData;
+	mLoadStats.peakMemory = std::max(mLoadStats.peakMemory, getMemoryUsage().total + temporaryMemory);
 }
 
-void Objex::setFace(unsigned int faceNumber, Face& faceData)
+void Objex::refreshDataPointers()
 {
-	mFaces[faceNumber] = faceData;
-	refreshLocalBoundingBox();
+	vertexData = mVertexArray.data();
+	normalData = mNormalArray.data();
+	textureData = mTextureArray.data();
+	colorData = mColorArray.data();
+	tangentData = mTangentArray.empty() ? nullptr : mTangentArray.data();
+	indexData = mShortIndexArray.empty() ? (mIndexArray.empty() ? nullptr : static_cast<GLvoid*>(mIndexArray.data())) : static_cast<GLvoid*>(mShortIndexArray.data());
+	interleavedData = mInterleavedArray.empty() ? nullptr : mInterleavedArray.data();
 }
 
-Objex::Vertex Objex::getVertex(unsigned int vertexNumber)
+void Objex::releaseSourceData()
 {
-	return mVertices[vertexNumber];
+	// swapped with empty vectors so that their memory is freed
+	std::vector<Vertex>().swap(mVertices);
+	std::vector<Vertex>().swap(mNormals);
+	std::vector<Vertex>().swap(mTextures);
+	std::vector<unsigned int>(1u, 0u).swap(mFaceFirstCorners);
+	std::vector<int>().swap(mFaceVertexIndices);
+	std::vector<int>().swap(mFaceNormalIndices);
+	std::vector<int>().swap(mFaceTextureIndices);
+	std::vector<int>().swap(mFaceMaterials);
+	std::vector<int>().swap(mFaceGroups);
+	std::vector<int>().swap(mFaceObjects);
+	std::vector<unsigned int>().swap(mFaceOrder);
+	std::vector<unsigned int>().swap(mClusterFirstFaces);
+	std::vector<unsigned int>().swap(mIndexedVertexCorners);
+	std::vector<std::string>().swap(mCommentLines);
+	std::vector<std::string>().swap(mUnprocessedLines);
+	clearChanges();
+	mHasSourceData = false;
 }
 
-Objex::Vertex Objex::getVertexNormal(unsigned int vertexNormalNumber)
+void Objex::loadMaterialLibraries(const std::string& directory)
 {
-	return mNormals[vertexNormalNumber];
+	for (const auto& materialLibrary : mMaterialLibraries)
+	{
+		if (!loadMaterialLibrary(directory + materialLibrary))
+			std::cerr << "Unable to load material library: " << directory + materialLibrary << std::endl;
+	}
 }
 
-Objex::Vertex Objex::getTextureVertex(unsigned int textureVertexNumber)
+void Objex::refreshFaceOrder()
 {
-	return mTextures[textureVertexNumber];
+	// faces are output grouped by material (faces without a material first, then in order of material) and otherwise in the order they were loaded (a stable counting sort)
+	std::vector<unsigned int> materialFirstPositions(mMaterials.size() + 2u, 0u);
+	for (const auto& material : mFaceMaterials)
+		++materialFirstPositions[material + 2];
+	for (std::size_t material{ 1u }; material < materialFirstPositions.size(); ++material)
+		materialFirstPositions[material] += materialFirstPositions[material - 1];
+	mFaceOrder.resize(getNumberOfFaces());
+	for (unsigned int face{ 0u }; face < getNumberOfFaces(); ++face)
+		mFaceOrder[materialFirstPositions[mFaceMaterials[face] + 1]++] = face;
+	refreshClusterOrder();
 }
 
-Objex::Face Objex::getFace(unsigned int faceNumber)
+void Objex::refreshClusterOrder()
 {
-	return mFaces[faceNumber];
-}
+	mClusterFirstFaces.clear();
+	if (!mOutputOptions.clusters)
+		return;
+
+	const unsigned int noCluster{ std::numeric_limits<unsigned int>::max() };
+	const unsigned int maximumTriangles{ std::max(mOutputOptions.maximumClusterTriangles, 1u) };
+	const unsigned int maximumVertices{ std::max(mOutputOptions.maximumClusterVertices, 3u) };
+	const std::size_t numberOfFaces{ getNumberOfFaces() };
+	auto getNumberOfCorners = [&](const unsigned int face) { return mFaceFirstCorners[face + 1] - mFaceFirstCorners[face]; };
+	auto isValidVertex = [&](const int vertex) { return (vertex >= 0) && (static_cast<std::size_t>(vertex) < mVertices.size()); };
+
+	// each corner's output vertex (its combination of indices, as refreshIndexedData() finds them). without indices, every triangle corner is a new vertex
+	std::vector<unsigned int> cornerVertices;
+	if (mOutputOptions.indexed)
+	{
+		std::unordered_map<IndexedCorner, unsigned int, IndexedCornerHash> vertexNumbers;
+		vertexNumbers.reserve(mVertices.size() * 2);
+		cornerVertices.resize(mFaceVertexIndices.size());
+		for (std::size_t corner{ 0u }; corner < mFaceVertexIndices.size(); ++corner)
+		{
+			const IndexedCorner indexedCorner{ mFaceVertexIndices[corner], mTextures.empty() ? -1 : mFaceTextureIndices[corner], mNormals.empty() ? -1 : mFaceNormalIndices[corner] };
+			cornerVertices[corner] = vertexNumbers.emplace(indexedCorner, static_cast<unsigned int>(vertexNumbers.size())).first->second;
+		}
+	}
+
+	// faces (with triangles) that use each vertex, and each face's centre
+	std::vector<unsigned int> vertexFirstFaces(mVertices.size() + 1, 0u);
+	std::vector<unsigned int> vertexFaces;
+	std::vector<float> faceCenters(numberOfFaces * 3, 0.f);
+	for (unsigned int face{ 0u }; face < numberOfFaces; ++face)
+	{
+		if (getNumberOfCorners(face) < 3)
+			continue;
+		unsigned int numberOfValidCorners{ 0u };
+		for (unsigned int corner{ mFaceFirstCorners[face] }; corner < mFaceFirstCorners[face + 1]; ++corner)
+		{
+			const int vertex{ mFaceVertexIndices[corner] };
+			if (!isValidVertex(vertex))
+				continue;
+			++vertexFirstFaces[vertex + 1];
+			faceCenters[face * 3] += mVertices[vertex].x;
+			faceCenters[face * 3 + 1] += mVertices[vertex].y;
+			faceCenters[face * 3 + 2] += mVertices[vertex].z;
+			++numberOfValidCorners;
+		}
+		for (unsigned int component{ 0u }; component < 3u; ++component)
+			faceCenters[face * 3 + component] /= std::max(numberOfValidCorners, 1u);
+	}
+	for (std::size_t vertex{ 1u }; vertex < vertexFirstFaces.size(); ++vertex)
+		vertexFirstFaces[vertex] += vertexFirstFaces[vertex - 1];
+	vertexFaces.resize(vertexFirstFaces.back());
+	{
+		std::vector<unsigned int> next(vertexFirstFaces.begin(), vertexFirstFaces.end() - 1);
+		for (unsigned int face{ 0u }; face < numberOfFaces; ++face)
+		{
+			if (getNumberOfCorners(face) < 3)
+				continue;
+			for (unsigned int corner{ mFaceFirstCorners[face] }; corner < mFaceFirstCorners[face + 1]; ++corner)
+			{
+				if (isValidVertex(mFaceVertexIndices[corner]))
+					vertexFaces[next[mFaceVertexIndices[corner]]++] = face;
+			}
+		}
+	}
+
+	// new clusters start from the first face left in Morton order (of the face centres) so that they follow each other through space
+	std::vector<std::uint32_t> mortonCodes(numberOfFaces, 0u);
+	if (numberOfFaces > 0u)
+	{
+		float minimum[3];
+		float maximum[3];
+		boundsKernel(faceCenters.data(), numberOfFaces, minimum, maximum);
+		for (std::size_t face{ 0u }; face < numberOfFaces; ++face)
+		{
+			std::uint32_t code{ 0u };
+			for (unsigned int component{ 0u }; component < 3u; ++component)
+			{
+				const float extent{ maximum[component] - minimum[component] };
+				std::uint32_t quantized{ (extent > 0.f) ? static_cast<std::uint32_t>((faceCenters[face * 3 + component] - minimum[component]) / extent * 1023.f) : 0u };
+				for (unsigned int bit{ 0u }; bit < 10u; ++bit)
+					code |= ((quantized >> bit) & 1u) << (bit * 3 + component);
+			}
+			mortonCodes[face] = code;
+		}
+	}
+
+	// clusters grow (within a material) by adding the neighbouring face that adds the fewest vertices and is closest to the cluster's centre, until a limit is reached
+	std::vector<unsigned int> faceClusters(numberOfFaces, noCluster);
+	std::vector<unsigned int> candidateClusters(numberOfFaces, noCluster); // cluster that each face was last a candidate for
+	std::vector<unsigned int> vertexClusters(mOutputOptions.indexed ? cornerVertices.size() : 0u, noCluster); // cluster that each output vertex was last added to
+	std::vector<unsigned int> order;
+	order.reserve(numberOfFaces);
+	std::vector<unsigned int> seeds;
+	std::vector<unsigned int> candidates;
+	unsigned int numberOfClusters{ 0u };
+	std::size_t materialBegin{ 0u };
+	while (materialBegin < mFaceOrder.size())
+	{
+		const int material{ mFaceMaterials[mFaceOrder[materialBegin]] };
+		std::size_t materialEnd{ materialBegin };
+		seeds.clear();
+		for (; (materialEnd < mFaceOrder.size()) && (mFaceMaterials[mFaceOrder[materialEnd]] == material); ++materialEnd)
+		{
+			if (getNumberOfCorners(mFaceOrder[materialEnd]) >= 3)
+				seeds.push_back(mFaceOrder[materialEnd]);
+		}
+		std::stable_sort(seeds.begin(), seeds.end(), [&](const unsigned int a, const unsigned int b) { return mortonCodes[a] < mortonCodes[b]; });
+
+		std::size_t nextSeed{ 0u };
+		unsigned int cluster{ noCluster };
+		unsigned int clusterTriangles{ 0u };
+		unsigned int clusterVertices{ 0u };
+		float clusterCenter[3]{ 0.f, 0.f, 0.f };
+		auto getNewVertices = [&](const unsigned int face)
+		{
+			if (!mOutputOptions.indexed)
+				return (getNumberOfCorners(face) - 2) * 3;
+			unsigned int newVertices{ 0u };
+			for (unsigned int corner{ mFaceFirstCorners[face] }; corner < mFaceFirstCorners[face + 1]; ++corner)
+			{
+				if (vertexClusters[cornerVertices[corner]] != cluster)
+					++newVertices;
+			}
+			return newVertices;
+		};
+		auto fits = [&](const unsigned int face, const unsigned int newVertices)
+		{
+			return (clusterTriangles == 0u) || ((clusterTriangles + getNumberOfCorners(face) - 2 <= maximumTriangles) && (clusterVertices + newVertices <= maximumVertices));
+		};
+		auto addFace = [&](const unsigned int face, const unsigned int newVertices)
+		{
+			faceClusters[face] = cluster;
+			order.push_back(face);
+			const float weight{ 1.f / (order.size() - mClusterFirstFaces.back()) };
+			for (unsigned int component{ 0u }; component < 3u; ++component)
+				clusterCenter[component] += (faceCenters[face * 3 + component] - clusterCenter[component]) * weight;
+			clusterTriangles += getNumberOfCorners(face) - 2;
+			clusterVertices += newVertices;
+			for (unsigned int corner{ mFaceFirstCorners[face] }; corner < mFaceFirstCorners[face + 1]; ++corner)
+			{
+				if (mOutputOptions.indexed)
+					vertexClusters[cornerVertices[corner]] = cluster;
+				// vertices shared by more faces than a cluster can hold (e.g. the centre of a large fan) would make every cluster that uses them scan them
+				const int vertex{ mFaceVertexIndices[corner] };
+				if (!isValidVertex(vertex) || (vertexFirstFaces[vertex + 1] - vertexFirstFaces[vertex] > maximumTriangles))
+					continue;
+				for (unsigned int i{ vertexFirstFaces[vertex] }; i < vertexFirstFaces[vertex + 1]; ++i)
+				{
+					const unsigned int neighbour{ vertexFaces[i] };
+					if ((faceClusters[neighbour] == noCluster) && (candidateClusters[neighbour] != cluster) && (mFaceMaterials[neighbour] == material))
+					{
+						candidateClusters[neighbour] = cluster;
+						candidates.push_back(neighbour);
+					}
+				}
+			}
+		};
+		while (true)
+		{
+			while ((nextSeed < seeds.size()) && (faceClusters[seeds[nextSeed]] != noCluster))
+				++nextSeed;
+			if (nextSeed == seeds.size())
+				break;
+
+			cluster = numberOfClusters++;
+			mClusterFirstFaces.push_back(static_cast<unsigned int>(order.size()));
+			clusterTriangles = 0u;
+			clusterVertices = 0u;
+			candidates.clear();
+			addFace(seeds[nextSeed], getNewVertices(seeds[nextSeed]));
+			while (true)
+			{
+				// candidates that are already used or no longer fit are removed
+				const std::size_t noCandidate{ std::numeric_limits<std::size_t>::max() };
+				std::size_t best{ noCandidate };
+				unsigned int bestNewVertices{ 0u };
+				float bestDistance{ 0.f };
+				for (std::size_t i{ 0u }; i < candidates.size();)
+				{
+					const unsigned int face{ candidates[i] };
+					const unsigned int newVertices{ (faceClusters[face] == noCluster) ? getNewVertices(face) : 0u };
+					if ((faceClusters[face] != noCluster) || !fits(face, newVertices))
+					{
+						candidates[i] = candidates.back();
+						candidates.pop_back();
+						if (best == candidates.size()) // the best was the last so has moved
+							best = i;
+						continue;
+					}
+					const float offset[3]{ faceCenters[face * 3] - clusterCenter[0], faceCenters[face * 3 + 1] - clusterCenter[1], faceCenters[face * 3 + 2] - clusterCenter[2] };
+					const float distance{ dot(offset, offset) };
+					if ((best == noCandidate) || (newVertices < bestNewVertices) || ((newVertices == bestNewVertices) && (distance < bestDistance)))
+					{
+						best = i;
+						bestNewVertices = newVertices;
+						bestDistance = distance;
+					}
+					++i;
+				}
+				if (best != noCandidate)
+				{
+					addFace(candidates[best], bestNewVertices);
+					continue;
+				}
 
-std::vector<Objex::Vertex> Objex::getAllVertices()
-{
-	return mVertices;
-}
+				// without neighbours (e.g. separate pieces), the next face in Morton order is used if it fits
+				while ((nextSeed < seeds.size()) && (faceClusters[seeds[nextSeed]] != noCluster))
+					++nextSeed;
+				if (nextSeed == seeds.size())
+					break;
+				const unsigned int newVertices{ getNewVertices(seeds[nextSeed]) };
+				if (!fits(seeds[nextSeed], newVertices))
+					break;
+				addFace(seeds[nextSeed], newVertices);
+			}
+		}
 
-std::vector<Objex::Vertex> Objex::getAllVertexNormals()
-{
-	return mNormals;
+		// faces without triangles are kept (after the material's clusters) but do not affect the output
+		for (std::size_t position{ materialBegin }; position < materialEnd; ++position)
+		{
+			if (getNumberOfCorners(mFaceOrder[position]) < 3)
+				order.push_back(mFaceOrder[position]);
+		}
+		materialBegin = materialEnd;
+	}
+	mFaceOrder.swap(order);
+	mClusterFirstFaces.push_back(static_cast<unsigned int>(mFaceOrder.size()));
 }
 
-std::vector<Objex::Vertex> Objex::getAllTextureVertices()
+void Objex::refreshSubmeshes()
 {
-	return mTextures;
+	// every triangle is three vertices (or three indices when indexed) in output order
+	mSubmeshes.clear();
+	mClusters.clear();
+	unsigned int first{ 0u };
+	std::size_t nextCluster{ 0u };
+	for (std::size_t position{ 0u }; position < mFaceOrder.size(); ++position)
+	{
+		const unsigned int face{ mFaceOrder[position] };
+		bool startsCluster{ false };
+		while ((nextCluster < mClusterFirstFaces.size()) && (mClusterFirstFaces[nextCluster] <= position))
+		{
+			startsCluster = true;
+			++nextCluster;
+		}
+		const unsigned int numberOfCorners{ mFaceFirstCorners[face + 1] - mFaceFirstCorners[face] };
+		if (numberOfCorners < 3)
+			continue;
+		if (mSubmeshes.empty() || (mSubmeshes.back().material != mFaceMaterials[face]))
+			mSubmeshes.push_back({ mFaceMaterials[face], first, 0u, Box() });
+		mSubmeshes.back().count += (numberOfCorners - 2) * 3;
+		if (startsCluster)
+			mClusters.push_back({ mFaceMaterials[face], first, 0u, Box(), Vertex{ 0.f, 0.f, 0.f }, 0.f, Vertex{ 0.f, 0.f, 0.f }, Vertex{ 0.f, 0.f, 0.f }, 2.f });
+		if (!mClusters.empty())
+			mClusters.back().count += (numberOfCorners - 2) * 3;
+		first += (numberOfCorners - 2) * 3;
+	}
+	refreshSubmeshBounds();
 }
 
-std::vector<Objex::Face> Objex::getAllFaces()
+void Objex::refreshSubmeshBounds()
 {
-	return mFaces;
+	if (!mShortIndexArray.empty())
+	{
+		refreshSubmeshBoxes(mSubmeshes, mVertexArray, mShortIndexArray);
+		refreshClusterBounds(mClusters, mVertexArray, mShortIndexArray);
+	}
+	else
+	{
+		refreshSubmeshBoxes(mSubmeshes, mVertexArray, mIndexArray);
+		refreshClusterBounds(mClusters, mVertexArray, mIndexArray);
+	}
+	for (auto& level : mLevelsOfDetail)
+	{
+		if (!level.shortIndices.empty())
+			refreshSubmeshBoxes(level.submeshes, mVertexArray, level.shortIndices);
+		else
+			refreshSubmeshBoxes(level.submeshes, mVertexArray, level.indices);
+	}
 }
 
-void Objex::randomizeColorData()
+void Objex::transferFaceToArray(const int* indices, const std::size_t numberOfIndices, const std::vector<Vertex>& vertices, GLfloat* destination, const Vertex& defaultVertex)
 {
-	unsigned int colorElementNumber{ 0 };
-	for (auto& colorElement : mColorArray)
+	if (numberOfIndices >= 3)
 	{
-		++colorElementNumber;
-		if (colorElementNumber < 4)
-			colorElement = static_cast<float>(rand() % 1000) / 1000;
-		else
+		unsigned int numberOfTriangles{ 1 };
+		if (numberOfIndices > 3)
+			numberOfTriangles = numberOfIndices - 2;
+		for (unsigned int triangle = 0; triangle < numberOfTriangles; ++triangle)
 		{
-			colorElementNumber = 0;
-			colorElement = 1.f;
+			for (unsigned int v = 0; v < 3; ++v)
+				destination = writeVertex(destination, vertices, (v == 0) ? indices[0] : indices[triangle + v], defaultVertex);
 		}
 	}
-}
 
-std::vector<std::string> Objex::getCommentLines()
-{
-	return mCommentLines;
 }
 
-std::vector<std::string> Objex::getUnprocessedLines()
+void Objex::refreshIndexedData()
 {
-	return mUnprocessedLines;
-}
-
-
-
+	// each triangle corner is looked up by its combination of indices. new combinations are added to the arrays as a new vertex
+	std::unordered_map<IndexedCorner, GLuint, IndexedCornerHash> vertexNumbers;
+	vertexNumbers.reserve(mVertices.size() * 2);
+	mIndexArray.reserve(countTriangles() * 3u);
+	std::vector<std::size_t> rangeFirstIndices; // where each material's (or cluster's) triangles start. they are only reordered within one so submeshes and clusters are unchanged
+	int material{ -1 };
+	std::size_t nextCluster{ 0u };
+	for (std::size_t position{ 0u }; position < mFaceOrder.size(); ++position)
+	{
+		const unsigned int face{ mFaceOrder[position] };
+		bool startsCluster{ false };
+		while ((nextCluster < mClusterFirstFaces.size()) && (mClusterFirstFaces[nextCluster] <= position))
+		{
+			startsCluster = true;
+			++nextCluster;
+		}
+		const unsigned int firstCorner{ mFaceFirstCorners[face] };
+		const unsigned int numberOfCorners{ mFaceFirstCorners[face + 1] - firstCorner };
+		if (numberOfCorners < 3)
+			continue;
+		if (rangeFirstIndices.empty() || (mFaceMaterials[face] != material) || startsCluster)
+		{
+			rangeFirstIndices.push_back(mIndexArray.size());
+			material = mFaceMaterials[face];
+		}
+		for (std::size_t triangle{ 0u }; triangle < numberOfCorners - 2; ++triangle)
+		{
+			for (std::size_t v{ 0u }; v < 3; ++v)
+			{
+				const std::size_t corner{ firstCorner + ((v == 0) ? 0u : triangle + v) };
+				const IndexedCorner indexedCorner{ mFaceVertexIndices[corner], mTextures.empty() ? -1 : mFaceTextureIndices[corner], mNormals.empty() ? -1 : mFaceNormalIndices[corner] };
+				const auto inserted = vertexNumbers.emplace(indexedCorner, static_cast<GLuint>(vertexNumbers.size()));
+				if (inserted.second)
+				{
+					mIndexedVertexCorners.push_back(static_cast<unsigned int>(corner));
+					appendVertex(mVertexArray, mVertices, indexedCorner.vertex, Vertex{ 0, 0, 0 });
+					appendVertex(mNormalArray, mNormals, indexedCorner.normal, Vertex{ 0, 0, 1 });
+					appendVertex(mTextureArray, mTextures, indexedCorner.texture, Vertex{ 0, 0, 0 });
+				}
+				mIndexArray.push_back(inserted.first->second);
+			}
+		}
+	}
 
+	rangeFirstIndices.push_back(mIndexArray.size());
+	optimizeIndexedData(rangeFirstIndices);
 
+	// use 16-bit indices if they can reach every vertex
+	if (vertexNumbers.size() <= 65536u)
+	{
+		mShortIndexArray.assign(mIndexArray.begin(), mIndexArray.end());
+		mIndexArray.clear();
+	}
+	mShortIndexArray.shrink_to_fit();
+	mIndexArray.shrink_to_fit();
+	mIndexedVertexCorners.shrink_to_fit();
+	indexData = mShortIndexArray.empty() ? static_cast<GLvoid*>(mIndexArray.data()) : static_cast<GLvoid*>(mShortIndexArray.data());
+}
 
+void Objex::optimizeIndexedData(const std::vector<std::size_t>& rangeFirstIndices)
+{
+	const std::size_t numberOfVertices{ mVertexArray.size() / 3 };
+	const unsigned int cacheSize{ std::max(mOutputOptions.vertexCacheSize, 1u) };
+	mUnoptimizedVertexCacheStatistics = simulateVertexCache(mIndexArray.data(), mIndexArray.size(), numberOfVertices, cacheSize);
+	if (getOutputOptimizations(mOutputOptions) == 0u)
+		return;
 
+	if (mOutputOptions.optimizeVertexCache)
+	{
+		std::vector<int> localVertices(numberOfVertices, -1);
+		for (std::size_t range{ 0u }; range + 1 < rangeFirstIndices.size(); ++range)
+			optimizeVertexCacheOrder(mIndexArray.data() + rangeFirstIndices[range], rangeFirstIndices[range + 1] - rangeFirstIndices[range], localVertices, cacheSize);
+		if (mOutputOptions.optimizeOverdraw)
+		{
+			std::vector<std::size_t> transformedAt(numberOfVertices, 0u);
+			for (std::size_t range{ 0u }; range + 1 < rangeFirstIndices.size(); ++range)
+				optimizeOverdrawOrder(mIndexArray.data() + rangeFirstIndices[range], rangeFirstIndices[range + 1] - rangeFirstIndices[range], mVertexArray, transformedAt, cacheSize);
+		}
+	}
 
-// PRIVATE
+	if (mOutputOptions.optimizeVertexFetch)
+	{
+		// vertices are numbered in the order they are first used (every vertex is used) and moved to match
+		std::vector<GLuint> newNumbers(numberOfVertices, 0u);
+		std::vector<char> isNumbered(numberOfVertices, 0);
+		GLuint nextNumber{ 0u };
+		for (auto& index : mIndexArray)
+		{
+			if (isNumbered[index] == 0)
+			{
+				isNumbered[index] = 1;
+				newNumbers[index] = nextNumber++;
+			}
+			index = newNumbers[index];
+		}
+		auto moveVertices = [&](std::vector<GLfloat>& array)
+		{
+			std::vector<GLfloat> moved(array.size());
+			for (std::size_t vertex{ 0u }; vertex < numberOfVertices; ++vertex)
+				std::copy(array.begin() + vertex * 3, array.begin() + vertex * 3 + 3, moved.begin() + newNumbers[vertex] * 3);
+			array.swap(moved);
+		};
+		moveVertices(mVertexArray);
+		moveVertices(mNormalArray);
+		moveVertices(mTextureArray);
+		std::vector<unsigned int> movedCorners(numberOfVertices);
+		for (std::size_t vertex{ 0u }; vertex < numberOfVertices; ++vertex)
+			movedCorners[newNumbers[vertex]] = mIndexedVertexCorners[vertex];
+		mIndexedVertexCorners.swap(movedCorners);
+	}
 
-std::string Objex::trimWhitespaceLeft(std::string s)
-{
-	const std::string delimiters{ " \f\n\r\t\v" };
-	s.erase(0, s.find_first_not_of(" "));
-	return s;
+	if (mLoadOptions.logInformation)
+	{
+		const VertexCacheStatistics statistics{ simulateVertexCache(mIndexArray.data(), mIndexArray.size(), numberOfVertices, cacheSize) };
+		std::clog << "Vertex cache ACMR: " << mUnoptimizedVertexCacheStatistics.acmr << " -> " << statistics.acmr << ", ATVR: " << mUnoptimizedVertexCacheStatistics.atvr << " -> " << statistics.atvr << std::endl;
+	}
 }
 
-std::string Objex::trimWhitespaceRight(std::string s)
+void Objex::buildBvhNode(std::vector<BvhNode>& nodes, std::vector<unsigned int>& order, const unsigned int first, const unsigned int count, const std::vector<float>& triangleBounds, const unsigned int depth, const unsigned int taskDepth, std::vector<unsigned int>& taskNodes) const
 {
-	const std::string delimiters{ " \f\n\r\t\v" };
-	s.erase(s.find_last_not_of(" ") + 1);
-	return s;
-}
+	// bounds of the triangles and of their centres
+	const unsigned int node{ static_cast<unsigned int>(nodes.size()) };
+	nodes.push_back(BvhNode());
+	BvhNode bvhNode;
+	float centreMinimum[3];
+	float centreMaximum[3];
+	for (unsigned int triangle{ first }; triangle < first + count; ++triangle)
+	{
+		const float* const bounds{ triangleBounds.data() + order[triangle] * 6 };
+		const float centre[3]{ (bounds[0] + bounds[3]) / 2.f, (bounds[1] + bounds[4]) / 2.f, (bounds[2] + bounds[5]) / 2.f };
+		if (triangle == first)
+		{
+			std::copy(bounds, bounds + 3, bvhNode.minimum);
+			std::copy(bounds + 3, bounds + 6, bvhNode.maximum);
+			std::copy(centre, centre + 3, centreMinimum);
+			std::copy(centre, centre + 3, centreMaximum);
+		}
+		includeInBounds(bounds, bounds + 3, bvhNode.minimum, bvhNode.maximum);
+		includeInBounds(centre, centre, centreMinimum, centreMaximum);
+	}
+	bvhNode.secondChildOrFirstTriangle = first;
+	bvhNode.numberOfTriangles = count;
+	nodes[node] = bvhNode;
+	if (depth == taskDepth)
+	{
+		taskNodes.push_back(node); // built separately
+		return;
+	}
 
-std::string Objex::trimWhitespace(const std::string& s)
-{
-	return trimWhitespaceLeft(trimWhitespaceRight(s));
-}
+	// the split with the lowest surface area heuristic cost of the planes between bins of triangle centres (on each axis)
+	float bestCost{ std::numeric_limits<float>::max() };
+	unsigned int bestAxis{ 0u };
+	unsigned int bestPlane{ 0u };
+	for (unsigned int axis{ 0u }; axis < 3u; ++axis)
+	{
+		const float extent{ centreMaximum[axis] - centreMinimum[axis] };
+		if (!(extent > 0.f))
+			continue;
+		unsigned int binCounts[numberOfBvhBins]{};
+		float binMinimums[numberOfBvhBins][3];
+		float binMaximums[numberOfBvhBins][3];
+		for (unsigned int bin{ 0u }; bin < numberOfBvhBins; ++bin)
+		{
+			std::fill(binMinimums[bin], binMinimums[bin] + 3, std::numeric_limits<float>::max());
+			std::fill(binMaximums[bin], binMaximums[bin] + 3, -std::numeric_limits<float>::max());
+		}
+		for (unsigned int triangle{ first }; triangle < first + count; ++triangle)
+		{
+			const float* const bounds{ triangleBounds.data() + order[triangle] * 6 };
+			const float centre{ (bounds[axis] + bounds[axis + 3]) / 2.f };
+			const unsigned int bin{ std::min(static_cast<unsigned int>((centre - centreMinimum[axis]) / extent * numberOfBvhBins), numberOfBvhBins - 1u) };
+			++binCounts[bin];
+			includeInBounds(bounds, bounds + 3, binMinimums[bin], binMaximums[bin]);
+		}
+		// areas and counts of everything to the right of each plane, then sweep from the left
+		float rightAreas[numberOfBvhBins];
+		unsigned int rightCounts[numberOfBvhBins];
+		float minimum[3]{ std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::max() };
+		float maximum[3]{ -std::numeric_limits<float>::max(), -std::numeric_limits<float>::max(), -std::numeric_limits<float>::max() };
+		unsigned int rightCount{ 0u };
+		for (unsigned int bin{ numberOfBvhBins - 1u }; bin > 0u; --bin)
+		{
+			rightCount += binCounts[bin];
+			includeInBounds(binMinimums[bin], binMaximums[bin], minimum, maximum);
+			rightCounts[bin] = rightCount;
+			rightAreas[bin] = (rightCount > 0u) ? getBoxArea(minimum, maximum) : 0.f;
+		}
+		std::fill(minimum, minimum + 3, std::numeric_limits<float>::max());
+		std::fill(maximum, maximum + 3, -std::numeric_limits<float>::max());
+		unsigned int leftCount{ 0u };
+		for (unsigned int plane{ 1u }; plane < numberOfBvhBins; ++plane)
+		{
+			leftCount += binCounts[plane - 1];
+			includeInBounds(binMinimums[plane - 1], binMaximums[plane - 1], minimum, maximum);
+			if ((leftCount == 0u) || (rightCounts[plane] == 0u))
+				continue;
+			const float cost{ getBoxArea(minimum, maximum) * leftCount + rightAreas[plane] * rightCounts[plane] };
+			if (cost < bestCost)
+			{
+				bestCost = cost;
+				bestAxis = axis;
+				bestPlane = plane;
+			}
+		}
+	}
 
-unsigned int Objex::getTokens(const std::string& line, std::vector<std::string>& tokens)
-{
-	tokens.resize(0);
-	std::string token;
-	std::istringstream ss(line);
-	while (getline(ss, token, ' '))
-		tokens.push_back(token);
-	return tokens.size();
-}
+	// a leaf is kept if there is no split (all centres are the same) or if it is small enough and splitting would cost more than testing all of its triangles
+	const float nodeArea{ getBoxArea(bvhNode.minimum, bvhNode.maximum) };
+	if ((bestPlane == 0u) || ((count <= mBvhOptions.maximumTrianglesPerLeaf) && (nodeArea > 0.f) && (1.f + bestCost / nodeArea >= static_cast<float>(count))))
+		return;
 
-void Objex::addTokensToVertexVector(const std::vector<std::string>& tokens, std::vector<Vertex>& vertices)
-{
-	vertices.push_back({ std::stof(tokens[0]), std::stof(tokens[1]), std::stof(tokens[2]) });
+	const float extent{ centreMaximum[bestAxis] - centreMinimum[bestAxis] };
+	const auto middle = std::partition(order.begin() + first, order.begin() + first + count, [&](const unsigned int triangle)
+	{
+		const float* const bounds{ triangleBounds.data() + triangle * 6 };
+		const float centre{ (bounds[bestAxis] + bounds[bestAxis + 3]) / 2.f };
+		return std::min(static_cast<unsigned int>((centre - centreMinimum[bestAxis]) / extent * numberOfBvhBins), numberOfBvhBins - 1u) < bestPlane;
+	});
+	const unsigned int firstCount{ static_cast<unsigned int>(middle - (order.begin() + first)) };
+	nodes[node].numberOfTriangles = 0u;
+	buildBvhNode(nodes, order, first, firstCount, triangleBounds, depth + 1, taskDepth, taskNodes);
+	nodes[node].secondChildOrFirstTriangle = static_cast<unsigned int>(nodes.size());
+	buildBvhNode(nodes, order, first + firstCount, count - firstCount, triangleBounds, depth + 1, taskDepth, taskNodes);
 }
 
-bool Objex::parse(const std::vector<std::string>& lines)
+void Objex::generateNormalData(const NormalOptions& options)
 {
-	mUnprocessedLines.resize(0);
-	mCommentLines.resize(0);
+	const std::size_t numberOfFaces{ getNumberOfFaces() };
+	const std::size_t numberOfCorners{ mFaceVertexIndices.size() };
+	const unsigned int numberOfThreads{ getNumberOfThreads(options.numberOfThreads) };
+	const std::size_t numberOfFaceTasks{ std::max<std::size_t>(std::min<std::size_t>(numberOfThreads * 4u, numberOfFaces / minimumFacesPerTask), 1u) };
+	const Vertex origin{ 0.f, 0.f, 0.f };
+	auto getPosition = [&](const unsigned int corner) -> const Vertex&
+	{
+		const int vertex{ mFaceVertexIndices[corner] };
+		return ((vertex >= 0) && (static_cast<std::size_t>(vertex) < mVertices.size())) ? mVertices[vertex] : origin;
+	};
 
-	std::clog << "parsing lines" << std::endl;
-	// parse lines
-	const unsigned int numberOfLines = lines.size();
-	unsigned int currentLine{ 0 };
-	float previousProgress{ 0.f };
-	for (auto line : lines)
+	// each face's unit normal (the sum of its triangles' normals so non-planar faces get their average) and each corner's contribution to smooth normals
+	std::vector<float> faceNormals(numberOfFaces * 3, 0.f);
+	std::vector<float> cornerContributions(options.smooth ? numberOfCorners * 3 : 0u);
+	std::vector<unsigned int> cornerFaces(options.smooth ? numberOfCorners : 0u);
+	runInParallel(numberOfFaceTasks, numberOfThreads, [&](const std::size_t task)
 	{
-		line = trimWhitespace(line);
-		if (line.length() > 1)
+		for (std::size_t face{ numberOfFaces * task / numberOfFaceTasks }; face < numberOfFaces * (task + 1) / numberOfFaceTasks; ++face)
 		{
-			const std::string singleCharCommandParameters{ trimWhitespace(line.substr(1)) };
-			const std::string doubleCharCommandParameters{ trimWhitespace(line.substr(2)) };
-			std::vector<std::string> tokens;
-			if (line.substr(0, 2) == "v ")
+			const unsigned int firstCorner{ mFaceFirstCorners[face] };
+			const unsigned int numberOfFaceCorners{ mFaceFirstCorners[face + 1] - firstCorner };
+			float* const faceNormal{ faceNormals.data() + face * 3 };
+			for (unsigned int triangle{ 0u }; triangle + 2 < numberOfFaceCorners; ++triangle)
 			{
-				if (getTokens(singleCharCommandParameters, tokens) == 3)
-					addTokensToVertexVector(tokens, mVertices);
+				float edges[2][3];
+				float triangleNormal[3];
+				subtract(getPosition(firstCorner + triangle + 1), getPosition(firstCorner), edges[0]);
+				subtract(getPosition(firstCorner + triangle + 2), getPosition(firstCorner), edges[1]);
+				cross(edges[0], edges[1], triangleNormal);
+				for (unsigned int component{ 0u }; component < 3u; ++component)
+					faceNormal[component] += triangleNormal[component];
 			}
-			else if (line.substr(0, 3) == "vn ")
+			// the sum's length is twice the face's area
+			const float areaWeight{ options.weightByArea ? std::sqrt(dot(faceNormal, faceNormal)) : 1.f };
+			normalize(faceNormal);
+			if (!options.smooth)
+				continue;
+			for (unsigned int corner{ firstCorner }; corner < firstCorner + numberOfFaceCorners; ++corner)
 			{
-				if (getTokens(doubleCharCommandParameters, tokens) == 3)
-					addTokensToVertexVector(tokens, mNormals);
+				const unsigned int previous{ (corner == firstCorner) ? firstCorner + numberOfFaceCorners - 1 : corner - 1 };
+				const unsigned int next{ (corner + 1 == firstCorner + numberOfFaceCorners) ? firstCorner : corner + 1 };
+				const float weight{ areaWeight * (options.weightByAngle ? getCornerAngle(getPosition(corner), getPosition(previous), getPosition(next)) : 1.f) };
+				for (unsigned int component{ 0u }; component < 3u; ++component)
+					cornerContributions[corner * 3 + component] = faceNormal[component] * weight;
+				cornerFaces[corner] = static_cast<unsigned int>(face);
 			}
-			else if (line.substr(0, 3) == "vt ")
+		}
+	});
+
+	// flat normals are the faces' normals
+	mFaceNormalIndices.assign(numberOfCorners, -1);
+	if (!options.smooth)
+	{
+		mNormals.resize(numberOfFaces);
+		for (std::size_t face{ 0u }; face < numberOfFaces; ++face)
+		{
+			const float* const faceNormal{ faceNormals.data() + face * 3 };
+			mNormals[face] = (dot(faceNormal, faceNormal) > 0.f) ? Vertex{ faceNormal[0], faceNormal[1], faceNormal[2] } : Vertex{ 0.f, 0.f, 1.f };
+			std::fill(mFaceNormalIndices.begin() + mFaceFirstCorners[face], mFaceNormalIndices.begin() + mFaceFirstCorners[face + 1], static_cast<int>(face));
+		}
+		return;
+	}
+
+	// a corner's smooth normal is the sum of the contributions of the corners at the same vertex whose faces are within the crease angle of its face
+	// corners whose normals are identical share one (the first of them at the vertex)
+	std::vector<unsigned int> vertexFirstCorners;
+	std::vector<unsigned int> vertexCorners;
+	buildVertexCorners(mFaceVertexIndices, mVertices.size(), vertexFirstCorners, vertexCorners);
+	const bool isCreased{ options.creaseAngle < 180.f };
+	const float minimumCosine{ std::cos(options.creaseAngle * 3.14159265358979f / 180.f) };
+	std::vector<float> cornerNormals(numberOfCorners * 3, 0.f);
+	std::vector<unsigned int> sharedCorners(numberOfCorners);
+	const std::size_t numberOfVertices{ mVertices.size() };
+	const std::size_t numberOfVertexTasks{ std::max<std::size_t>(std::min<std::size_t>(numberOfThreads * 4u, numberOfVertices / minimumVerticesPerTask), 1u) };
+	runInParallel(numberOfVertexTasks, numberOfThreads, [&](const std::size_t task)
+	{
+		for (std::size_t vertex{ numberOfVertices * task / numberOfVertexTasks }; vertex < numberOfVertices * (task + 1) / numberOfVertexTasks; ++vertex)
+		{
+			const unsigned int* const first{ vertexCorners.data() + vertexFirstCorners[vertex] };
+			const unsigned int* const last{ vertexCorners.data() + vertexFirstCorners[vertex + 1] };
+			float vertexSum[3]{ 0.f, 0.f, 0.f };
+			if (!isCreased)
 			{
-				getTokens(doubleCharCommandParameters, tokens);
-				if ((tokens.size() >= 1) && (tokens.size() <= 3))
+				for (const unsigned int* other{ first }; other != last; ++other)
 				{
-					tokens.resize(3, "0");
-					addTokensToVertexVector(tokens, mTextures);
+					for (unsigned int component{ 0u }; component < 3u; ++component)
+						vertexSum[component] += cornerContributions[*other * 3 + component];
 				}
 			}
-			else if (line.substr(0, 2) == "f ")
+			for (const unsigned int* corner{ first }; corner != last; ++corner)
 			{
-				Objex::Face face;
-				std::istringstream ss(line);
-				std::vector<std::string> tokens;
-				getTokens(singleCharCommandParameters, tokens);
-				if ((tokens.size() >= 3) && (tokens.size() <= 4))
+				const float* const faceNormal{ faceNormals.data() + cornerFaces[*corner] * 3 };
+				float* const normal{ cornerNormals.data() + *corner * 3 };
+				std::copy(vertexSum, vertexSum + 3, normal);
+				if (isCreased)
 				{
-					for (auto t : tokens)
+					for (const unsigned int* other{ first }; other != last; ++other)
 					{
-						std::string index;
-						std::vector<std::string> indices;
-						std::istringstream ts(t);
-						while (getline(ts, index, '/')) // split token into 3 values using slash as delimiter. when the index is not present, an empty one may need to be created when stored (when importer is expanded to include other index types)
-							indices.push_back(index);
-						if (indices.size() >= 1) // first index in the token is the vertex index
-						{
-							int indexValue{ std::stoi(indices[0]) - 1 };
-							if (indexValue < 0)
-								face.vertexIndices.push_back(mVertices.size() + indexValue); // vertex index from offset (relative positioning)
-							else
-								face.vertexIndices.push_back(indexValue); // "- 1" is to convert index from one-based index (in the file) to zero-based index (in an array/vector)
-							if (indices.size() >= 2) // texture vertex index is present (second index)
-							{
-								indexValue = std::stoi(indices[1]) - 1;
-								if (indexValue < 0)
-									face.vertexIndices.push_back(mVertices.size() + indexValue); // vertex index from offset (relative positioning)
-								else
-									face.textureIndices.push_back(indexValue);
-								if (indices.size() >= 3) // vertex normal index is present (third index)
-								{
-									indexValue = std::stoi(indices[2]) - 1;
-									if (indexValue < 0)
-										face.vertexIndices.push_back(mVertices.size() + indexValue); // vertex index from offset (relative positioning)
-									else
-										face.normalIndices.push_back(indexValue);
-								}
-							}
-						}
+						if (dot(faceNormal, faceNormals.data() + cornerFaces[*other] * 3) < minimumCosine)
+							continue;
+						for (unsigned int component{ 0u }; component < 3u; ++component)
+							normal[component] += cornerContributions[*other * 3 + component];
 					}
-					if (face.normalIndices.size() != face.vertexIndices.size()) // if normals are not provided for each vertex, set them to the default normal (index of -1)
-					{
-						// normal index of -1 becomes default normal of (0.0, 0.0, 1.0)
-						face.normalIndices.resize(face.vertexIndices.size());
-						for (auto& normalIndex : face.normalIndices)
-							normalIndex = -1;
-					}
-					if (face.textureIndices.size() != face.vertexIndices.size()) // if texture vertices are not provided for each vertex, set them to the default vertex (index of -1)
+				}
+				if (!normalize(normal))
+				{
+					const bool hasFaceNormal{ dot(faceNormal, faceNormal) > 0.f };
+					normal[0] = hasFaceNormal ? faceNormal[0] : 0.f;
+					normal[1] = hasFaceNormal ? faceNormal[1] : 0.f;
+					normal[2] = hasFaceNormal ? faceNormal[2] : 1.f;
+				}
+				sharedCorners[*corner] = *corner;
+				for (const unsigned int* other{ first }; other != corner; ++other)
+				{
+					if (std::equal(normal, normal + 3, cornerNormals.data() + *other * 3))
 					{
-						// texture vertex index of -1 becomes default texture index of (0.0, 0.0, 0.0)
-						face.textureIndices.resize(face.vertexIndices.size());
-						for (auto& textureIndex : face.textureIndices)
-							textureIndex = -1;
+						sharedCorners[*corner] = sharedCorners[*other];
+						break;
 					}
 				}
-				mFaces.push_back(face);
-
 			}
-			else if (line.front() == '#')
-				mCommentLines.push_back(singleCharCommandParameters);
-			else
-				mUnprocessedLines.push_back(line);
 		}
-		else if (line == "#")
-			mCommentLines.push_back("");
-		else
-			mUnprocessedLines.push_back(line);
+	});
 
-		// show percentage of progress. only updates if percentage has changed (whole numbers only)
-		float progress{ round(static_cast<float>(currentLine)* 100 / numberOfLines) };
-		if (progress != previousProgress)
-			std::clog << "Parsing " << progress << "%" << std::endl;
-		previousProgress = progress;
-		++currentLine;
+	// number the normals in order of vertex
+	mNormals.clear();
+	for (const auto& corner : vertexCorners)
+	{
+		if (sharedCorners[corner] == corner)
+		{
+			mFaceNormalIndices[corner] = static_cast<int>(mNormals.size());
+			mNormals.push_back({ cornerNormals[corner * 3], cornerNormals[corner * 3 + 1], cornerNormals[corner * 3 + 2] });
+		}
+		else
+			mFaceNormalIndices[corner] = mFaceNormalIndices[sharedCorners[corner]];
 	}
+}
 
-	std::clog << "Lines in file: " << lines.size() << std::endl;
-	std::clog << "Comment lines: " << mCommentLines.size() << std::endl;
-	std::clog << "Unprocessed lines: " << mUnprocessedLines.size() << std::endl;
+void Objex::refreshTangentData()
+{
+	mTangentArray.clear();
+	tangentData = nullptr;
+	if (!mOutputOptions.tangents)
+		return;
 
-	// generate container to store all data in order required by OpenGL
-	refreshData();
-	createColorArray();
+	const std::size_t numberOfFaces{ getNumberOfFaces() };
+	const std::size_t numberOfCorners{ mFaceVertexIndices.size() };
+	const unsigned int numberOfThreads{ getNumberOfThreads(mOutputOptions.numberOfThreads) };
+	const std::size_t numberOfFaceTasks{ std::max<std::size_t>(std::min<std::size_t>(numberOfThreads * 4u, numberOfFaces / minimumFacesPerTask), 1u) };
+	const Vertex origin{ 0.f, 0.f, 0.f };
+	auto getPosition = [&](const unsigned int corner) -> const Vertex&
+	{
+		const int vertex{ mFaceVertexIndices[corner] };
+		return ((vertex >= 0) && (static_cast<std::size_t>(vertex) < mVertices.size())) ? mVertices[vertex] : origin;
+	};
+	auto hasTexture = [&](const unsigned int corner)
+	{
+		return (mFaceTextureIndices[corner] >= 0) && (static_cast<std::size_t>(mFaceTextureIndices[corner]) < mTextures.size());
+	};
 
-	return true;
-}
+	// each triangle's directions of increasing u (tangent) and v (bitangent), normalized and weighted by the triangle's angle at each corner (as MikkTSpace)
+	std::vector<float> cornerDirections(numberOfCorners * 6, 0.f);
+	runInParallel(numberOfFaceTasks, numberOfThreads, [&](const std::size_t task)
+	{
+		for (std::size_t face{ numberOfFaces * task / numberOfFaceTasks }; face < numberOfFaces * (task + 1) / numberOfFaceTasks; ++face)
+		{
+			const unsigned int firstCorner{ mFaceFirstCorners[face] };
+			const unsigned int numberOfFaceCorners{ mFaceFirstCorners[face + 1] - firstCorner };
+			for (unsigned int triangle{ 0u }; triangle + 2 < numberOfFaceCorners; ++triangle)
+			{
+				const unsigned int corners[3]{ firstCorner, firstCorner + triangle + 1, firstCorner + triangle + 2 };
+				if (!hasTexture(corners[0]) || !hasTexture(corners[1]) || !hasTexture(corners[2]))
+					continue;
+				const Vertex& texture0(mTextures[mFaceTextureIndices[corners[0]]]);
+				const Vertex& texture1(mTextures[mFaceTextureIndices[corners[1]]]);
+				const Vertex& texture2(mTextures[mFaceTextureIndices[corners[2]]]);
+				const float u1{ texture1.x - texture0.x }, v1{ texture1.y - texture0.y };
+				const float u2{ texture2.x - texture0.x }, v2{ texture2.y - texture0.y };
+				const float determinant{ u1 * v2 - u2 * v1 };
+				if (determinant == 0.f)
+					continue;
+				float edges[2][3];
+				subtract(getPosition(corners[1]), getPosition(corners[0]), edges[0]);
+				subtract(getPosition(corners[2]), getPosition(corners[0]), edges[1]);
+				float tangent[3];
+				float bitangent[3];
+				for (unsigned int component{ 0u }; component < 3u; ++component)
+				{
+					tangent[component] = (edges[0][component] * v2 - edges[1][component] * v1) / determinant;
+					bitangent[component] = (edges[1][component] * u1 - edges[0][component] * u2) / determinant;
+				}
+				if (!normalize(tangent) || !normalize(bitangent))
+					continue;
+				for (unsigned int v{ 0u }; v < 3u; ++v)
+				{
+					const float angle{ getCornerAngle(getPosition(corners[v]), getPosition(corners[(v + 2) % 3]), getPosition(corners[(v + 1) % 3])) };
+					float* const directions{ cornerDirections.data() + corners[v] * 6 };
+					for (unsigned int component{ 0u }; component < 3u; ++component)
+					{
+						directions[component] += tangent[component] * angle;
+						directions[3 + component] += bitangent[component] * angle;
+					}
+				}
+			}
+		}
+	});
 
-void Objex::transferFaceToArray(const std::vector<int>& indices, const std::vector<Vertex>& vertices, std::vector<GLfloat>& destinationArray, const Vertex& defaultVertex)
-{
-	if (indices.size() >= 3)
+	// corners with the same vertex, normal and texture vertex are the same output vertex so share the sum of their directions
+	// the tangent is made perpendicular to the normal and the bitangent only decides the handedness
+	std::vector<unsigned int> vertexFirstCorners;
+	std::vector<unsigned int> vertexCorners;
+	buildVertexCorners(mFaceVertexIndices, mVertices.size(), vertexFirstCorners, vertexCorners);
+	std::vector<float> cornerTangents(numberOfCorners * 4, 0.f);
+	for (std::size_t corner{ 0u }; corner < numberOfCorners; ++corner)
 	{
-		unsigned int numberOfTriangles{ 1 };
-		if (indices.size() > 3)
-			numberOfTriangles = indices.size() - 2;
-		for (unsigned int triangle = 0; triangle < numberOfTriangles; ++triangle)
+		cornerTangents[corner * 4] = 1.f;
+		cornerTangents[corner * 4 + 3] = 1.f;
+	}
+	const std::size_t numberOfVertices{ mVertices.size() };
+	const std::size_t numberOfVertexTasks{ std::max<std::size_t>(std::min<std::size_t>(numberOfThreads * 4u, numberOfVertices / minimumVerticesPerTask), 1u) };
+	runInParallel(numberOfVertexTasks, numberOfThreads, [&](const std::size_t task)
+	{
+		for (std::size_t vertex{ numberOfVertices * task / numberOfVertexTasks }; vertex < numberOfVertices * (task + 1) / numberOfVertexTasks; ++vertex)
 		{
-			for (unsigned int v = 0; v < 3; ++v)
+			const unsigned int* const first{ vertexCorners.data() + vertexFirstCorners[vertex] };
+			const unsigned int* const last{ vertexCorners.data() + vertexFirstCorners[vertex + 1] };
+			for (const unsigned int* corner{ first }; corner != last; ++corner)
 			{
-				if (vertices.size() > 0)
+				float tangent[3]{ 0.f, 0.f, 0.f };
+				float bitangent[3]{ 0.f, 0.f, 0.f };
+				for (const unsigned int* other{ first }; other != last; ++other)
 				{
-					if (v == 0)
+					if ((mFaceNormalIndices[*other] != mFaceNormalIndices[*corner]) || (mFaceTextureIndices[*other] != mFaceTextureIndices[*corner]))
+						continue;
+					for (unsigned int component{ 0u }; component < 3u; ++component)
 					{
-						destinationArray.push_back(vertices[indices[0]].x);
-						destinationArray.push_back(vertices[indices[0]].y);
-						destinationArray.push_back(vertices[indices[0]].z);
+						tangent[component] += cornerDirections[*other * 6 + component];
+						bitangent[component] += cornerDirections[*other * 6 + 3 + component];
 					}
-					else
+				}
+				const int normalIndex{ mFaceNormalIndices[*corner] };
+				float normal[3]{ 0.f, 0.f, 1.f };
+				if ((normalIndex >= 0) && (static_cast<std::size_t>(normalIndex) < mNormals.size()))
+				{
+					normal[0] = mNormals[normalIndex].x;
+					normal[1] = mNormals[normalIndex].y;
+					normal[2] = mNormals[normalIndex].z;
+					if (!normalize(normal))
 					{
-						destinationArray.push_back(vertices[indices[triangle + v]].x);
-						destinationArray.push_back(vertices[indices[triangle + v]].y);
-						destinationArray.push_back(vertices[indices[triangle + v]].z);
+						normal[0] = 0.f;
+						normal[1] = 0.f;
+						normal[2] = 1.f;
 					}
 				}
-				else // default vertex
+				const float normalPart{ dot(normal, tangent) };
+				for (unsigned int component{ 0u }; component < 3u; ++component)
+					tangent[component] -= normal[component] * normalPart;
+				if (!normalize(tangent))
 				{
-					destinationArray.push_back(defaultVertex.x);
-					destinationArray.push_back(defaultVertex.y);
-					destinationArray.push_back(defaultVertex.z);
+					// any direction perpendicular to the normal
+					const float axis[3]{ (std::abs(normal[0]) < 0.9f) ? 1.f : 0.f, (std::abs(normal[0]) < 0.9f) ? 0.f : 1.f, 0.f };
+					float perpendicular[3];
+					cross(axis, normal, perpendicular);
+					cross(normal, perpendicular, tangent);
+					normalize(tangent);
 				}
+				float expectedBitangent[3];
+				cross(normal, tangent, expectedBitangent);
+				float* const result{ cornerTangents.data() + *corner * 4 };
+				std::copy(tangent, tangent + 3, result);
+				result[3] = (dot(expectedBitangent, bitangent) < 0.f) ? -1.f : 1.f;
+			}
+		}
+	});
+
+	std::vector<unsigned int> outputCorners;
+	getOutputCorners(outputCorners);
+	mTangentArray.resize(outputCorners.size() * 4);
+	mTangentArray.shrink_to_fit();
+	for (std::size_t outputVertex{ 0u }; outputVertex < outputCorners.size(); ++outputVertex)
+		std::copy(cornerTangents.begin() + outputCorners[outputVertex] * 4, cornerTangents.begin() + outputCorners[outputVertex] * 4 + 4, mTangentArray.begin() + outputVertex * 4);
+	tangentData = mTangentArray.empty() ? nullptr : mTangentArray.data();
+}
+
+void Objex::refreshInterleavedData()
+{
+	// calculate offsets (each attribute is aligned to 4 bytes) and stride
+	mInterleavedStride = 0u;
+	for (auto& offset : mInterleavedOffsets)
+		offset = -1;
+	for (const auto& format : mOutputOptions.interleavedLayout)
+	{
+		mInterleavedStride = (mInterleavedStride + 3u) / 4u * 4u;
+		mInterleavedOffsets[static_cast<int>(format.attribute)] = static_cast<int>(mInterleavedStride);
+		mInterleavedStride += format.numberOfComponents * getComponentSize(format.componentType);
+	}
+	const unsigned int alignment{ std::max(mOutputOptions.interleavedStrideAlignment, 1u) };
+	mInterleavedStride = (mInterleavedStride + alignment - 1u) / alignment * alignment;
+
+	mPositionDequantization = calculatePositionDequantization();
+	const std::size_t numberOfVertices{ mVertexArray.size() / 3 };
+	mInterleavedArray.assign(numberOfVertices * mInterleavedStride, 0u);
+	mInterleavedArray.shrink_to_fit();
+	interleavedData = mInterleavedArray.empty() ? nullptr : mInterleavedArray.data();
+	for (std::size_t vertex{ 0u }; vertex < numberOfVertices; ++vertex)
+		writeInterleavedVertex(vertex);
+}
+
+void Objex::writeInterleavedVertex(const std::size_t vertexNumber)
+{
+	if (mInterleavedArray.empty())
+		return;
+
+	const bool hasColors{ mColorArray.size() == mVertexArray.size() / 3 * 4 }; // colours are created after the first refresh so are not available until then
+	unsigned char* const vertex{ mInterleavedArray.data() + vertexNumber * mInterleavedStride };
+	unsigned int offset{ 0u };
+	for (const auto& format : mOutputOptions.interleavedLayout)
+	{
+		offset = (offset + 3u) / 4u * 4u;
+		const unsigned int componentSize{ getComponentSize(format.componentType) };
+		const std::vector<GLfloat>* source;
+		unsigned int sourceStride{ 3u };
+		switch (format.attribute)
+		{
+		case Attribute::Normal:
+			source = &mNormalArray;
+			break;
+		case Attribute::Texture:
+			source = &mTextureArray;
+			break;
+		case Attribute::Color:
+			source = hasColors ? &mColorArray : nullptr;
+			sourceStride = 4u;
+			break;
+		case Attribute::Tangent:
+			source = mTangentArray.empty() ? nullptr : &mTangentArray;
+			sourceStride = 4u;
+			break;
+		case Attribute::Position:
+		default:
+			source = &mVertexArray;
+			break;
+		}
+		float values[4]{ 0.f, 0.f, 0.f, 1.f };
+		if ((source == nullptr) && (format.attribute == Attribute::Color))
+			values[0] = values[1] = values[2] = 1.f; // colours are white until created (tangents that are not output are (0, 0, 0, 1))
+		else if (source != nullptr)
+		{
+			for (unsigned int component{ 0u }; component < sourceStride; ++component)
+				values[component] = (*source)[vertexNumber * sourceStride + component];
+		}
+		if ((format.encoding == Encoding::BoundingBox) && (format.attribute == Attribute::Position))
+		{
+			const float scale[3]{ mPositionDequantization.scale.x, mPositionDequantization.scale.y, mPositionDequantization.scale.z };
+			const float quantizationOffset[3]{ mPositionDequantization.offset.x, mPositionDequantization.offset.y, mPositionDequantization.offset.z };
+			for (unsigned int component{ 0u }; component < 3u; ++component)
+				values[component] = (scale[component] > 0.f) ? (values[component] - quantizationOffset[component]) / scale[component] : 0.f;
+		}
+		else if (format.encoding == Encoding::Octahedral)
+		{
+			encodeOctahedral(values);
+			if (!isSigned(format.componentType) && (format.componentType != ComponentType::Float) && (format.componentType != ComponentType::HalfFloat))
+			{
+				for (auto& value : values)
+					value = value * 0.5f + 0.5f;
 			}
 		}
+		for (unsigned int component{ 0u }; component < format.numberOfComponents; ++component)
+			writeComponent(vertex + offset + component * componentSize, format.componentType, values[component]);
+		offset += format.numberOfComponents * componentSize;
+	}
+}
+
+Objex::Dequantization Objex::calculatePositionDequantization()
+{
+	Dequantization dequantization{ { 1.f, 1.f, 1.f }, { 0.f, 0.f, 0.f } };
+	for (const auto& format : mOutputOptions.interleavedLayout)
+	{
+		if ((format.attribute != Attribute::Position) || (format.encoding != Encoding::BoundingBox))
+			continue;
+		if (mIsLocalBoundingBoxOutdated)
+			refreshLocalBoundingBox();
+		const Box& box{ mLocalBoundingBox };
+		if (isSigned(format.componentType)) // [-1, 1] is the whole box so the offset is its centre
+			dequantization = { { box.width / 2, box.height / 2, box.depth / 2 }, { box.left + box.width / 2, box.bottom + box.height / 2, box.back + box.depth / 2 } };
+		else
+			dequantization = { { box.width, box.height, box.depth }, { box.left, box.bottom, box.back } };
+	}
+	return dequantization;
+}
+
+void Objex::changeVertex(const unsigned int vertexNumber, const Vertex& vertexData)
+{
+	// the bounding box only needs to be recalculated if the vertex was on its edge (it may shrink). otherwise, it can just grow to include the new position
+	// while editing, it is recalculated once when committed instead
+	if (!mIsEditing && !mIsLocalBoundingBoxOutdated)
+	{
+		const Vertex& previous(mVertices[vertexNumber]);
+		if ((previous.x == mLocalBoundingBox.left) || (previous.x == mLocalBoundingBox.right) || (previous.y == mLocalBoundingBox.bottom) || (previous.y == mLocalBoundingBox.top) || (previous.z == mLocalBoundingBox.back) || (previous.z == mLocalBoundingBox.front))
+			mIsLocalBoundingBoxOutdated = true;
+		else
+			includeInLocalBoundingBox(vertexData);
+	}
+	else
+		mIsLocalBoundingBoxOutdated = true;
+	mVertices[vertexNumber] = vertexData;
+	mChangedVertices.push_back(vertexNumber);
+}
+
+void Objex::storeFace(const unsigned int faceNumber, const Face& face)
+{
+	// make space for the face's corners if it has a different number of them than before
+	const unsigned int firstCorner{ mFaceFirstCorners[faceNumber] };
+	const unsigned int previousNumberOfCorners{ mFaceFirstCorners[faceNumber + 1] - firstCorner };
+	const unsigned int numberOfCorners{ static_cast<unsigned int>(face.vertexIndices.size()) };
+	if (numberOfCorners != previousNumberOfCorners)
+	{
+		for (auto indices : { &mFaceVertexIndices, &mFaceNormalIndices, &mFaceTextureIndices })
+		{
+			if (numberOfCorners > previousNumberOfCorners)
+				indices->insert(indices->begin() + firstCorner + previousNumberOfCorners, numberOfCorners - previousNumberOfCorners, -1);
+			else
+				indices->erase(indices->begin() + firstCorner + numberOfCorners, indices->begin() + firstCorner + previousNumberOfCorners);
+		}
+		for (std::size_t face{ faceNumber + 1u }; face < mFaceFirstCorners.size(); ++face)
+			mFaceFirstCorners[face] = mFaceFirstCorners[face] + numberOfCorners - previousNumberOfCorners;
+	}
+
+	// normals and texture vertices that are not provided for each vertex are the default (index of -1)
+	std::copy(face.vertexIndices.begin(), face.vertexIndices.end(), mFaceVertexIndices.begin() + firstCorner);
+	if (face.normalIndices.size() == numberOfCorners)
+		std::copy(face.normalIndices.begin(), face.normalIndices.end(), mFaceNormalIndices.begin() + firstCorner);
+	else
+		std::fill_n(mFaceNormalIndices.begin() + firstCorner, numberOfCorners, -1);
+	if (face.textureIndices.size() == numberOfCorners)
+		std::copy(face.textureIndices.begin(), face.textureIndices.end(), mFaceTextureIndices.begin() + firstCorner);
+	else
+		std::fill_n(mFaceTextureIndices.begin() + firstCorner, numberOfCorners, -1);
+}
+
+void Objex::clearChanges()
+{
+	mChangedVertices.clear();
+	mChangedNormals.clear();
+	mChangedTextures.clear();
+	mAreFacesChanged = false;
+	mVertexOutputMap = OutputVertexMap();
+	mNormalOutputMap = OutputVertexMap();
+	mTextureOutputMap = OutputVertexMap();
+}
+
+void Objex::getOutputCorners(std::vector<unsigned int>& corners) const
+{
+	// each indexed output vertex is created from a single corner (whatever order its triangles are in)
+	if (mOutputOptions.indexed)
+	{
+		corners = mIndexedVertexCorners;
+		return;
+	}
+
+	// each triangle corner of non-indexed output, in the order refreshData creates them
+	corners.clear();
+	corners.reserve(mVertexArray.size() / 3);
+	for (const auto& face : mFaceOrder)
+	{
+		const unsigned int firstCorner{ mFaceFirstCorners[face] };
+		const unsigned int numberOfCorners{ mFaceFirstCorners[face + 1] - firstCorner };
+		if (numberOfCorners < 3)
+			continue;
+		for (unsigned int triangle{ 0u }; triangle < numberOfCorners - 2; ++triangle)
+		{
+			for (unsigned int v{ 0u }; v < 3; ++v)
+				corners.push_back(firstCorner + ((v == 0) ? 0u : triangle + v));
+		}
 	}
+}
+
+void Objex::buildOutputVertexMaps()
+{
+	// face corner (position in the face index lists) of each output vertex
+	std::vector<unsigned int> corners;
+	getOutputCorners(corners);
+
+	auto build = [&](OutputVertexMap& map, const std::size_t numberOfElements, const std::vector<int>& indices)
+	{
+		map.first.assign(numberOfElements + 1, 0u);
+		for (const auto& corner : corners)
+		{
+			if (indices[corner] >= 0)
+				++map.first[indices[corner] + 1];
+		}
+		for (std::size_t element{ 0u }; element < numberOfElements; ++element)
+			map.first[element + 1] += map.first[element];
+		map.outputVertices.resize(map.first.back());
+		std::vector<unsigned int> next(map.first.begin(), map.first.end() - 1);
+		for (std::size_t triangleCorner{ 0u }; triangleCorner < corners.size(); ++triangleCorner)
+		{
+			const int index{ indices[corners[triangleCorner]] };
+			if (index >= 0)
+				map.outputVertices[next[index]++] = static_cast<unsigned int>(triangleCorner);
+		}
+	};
+	build(mVertexOutputMap, mVertices.size(), mFaceVertexIndices);
+	build(mNormalOutputMap, mNormals.size(), mFaceNormalIndices);
+	build(mTextureOutputMap, mTextures.size(), mFaceTextureIndices);
+}
 
+void Objex::refreshChangedElements(std::vector<unsigned int>& changedElements, const std::vector<Vertex>& elements, const OutputVertexMap& outputMap, std::vector<GLfloat>& destinationArray, std::vector<unsigned int>& changedOutputVertices)
+{
+	std::sort(changedElements.begin(), changedElements.end());
+	changedElements.erase(std::unique(changedElements.begin(), changedElements.end()), changedElements.end());
+	for (const auto& element : changedElements)
+	{
+		for (unsigned int i{ outputMap.first[element] }; i < outputMap.first[element + 1]; ++i)
+		{
+			const unsigned int outputVertex{ outputMap.outputVertices[i] };
+			destinationArray[outputVertex * 3] = elements[element].x;
+			destinationArray[outputVertex * 3 + 1] = elements[element].y;
+			destinationArray[outputVertex * 3 + 2] = elements[element].z;
+			changedOutputVertices.push_back(outputVertex);
+		}
+	}
 }
 
 void Objex::createColorArray()
 {
 	mColorArray.resize(0);
+	mColorArray.shrink_to_fit();
+	mColorArray.reserve(mVertexArray.size() / 3 * 4);
 	enum ColorCreationType{ RandomPerTriangle, RandomPerVertex, Other };
-	const ColorCreationType colorCreation{ RandomPerTriangle };
+	const ColorCreationType colorCreation{ mOutputOptions.indexed ? RandomPerVertex : RandomPerTriangle }; // vertices are shared between triangles when indexed
 	if (colorCreation == RandomPerTriangle)
 	{
 		// create random colour per triangle
@@ -430,32 +5397,89 @@ void Objex::createColorArray()
 			mColorArray.push_back(1); // alpha
 		}
 	}
-	colorData = &mColorArray.front();
+	colorData = mColorArray.data();
+	refreshInterleavedData();
+}
+
+void Objex::refreshLocalBoundingBox() const
+{
+	mIsLocalBoundingBoxOutdated = false;
+	// without source data, the output's positions are used instead (they are copies of the vertices)
+	const float* const positions{ mHasSourceData ? (mVertices.empty() ? nullptr : &mVertices.front().x) : mVertexArray.data() };
+	const std::size_t numberOfPositions{ mHasSourceData ? mVertices.size() : mVertexArray.size() / 3 };
+	if (numberOfPositions == 0u)
+	{
+		mLocalBoundingBox = Box();
+		return;
+	}
+	float minimum[3];
+	float maximum[3];
+	boundsKernel(positions, numberOfPositions, minimum, maximum);
+	mLocalBoundingBox = makeBox(minimum, maximum);
+}
+
+std::size_t Objex::countTriangles() const
+{
+	std::size_t numberOfTriangles{ 0u };
+	for (std::size_t face{ 0u }; face < getNumberOfFaces(); ++face)
+	{
+		const unsigned int numberOfCorners{ mFaceFirstCorners[face + 1] - mFaceFirstCorners[face] };
+		if (numberOfCorners >= 3)
+			numberOfTriangles += numberOfCorners - 2;
+	}
+	return numberOfTriangles;
+}
+
+void Objex::transformPositions(const float matrix[16], const bool refreshOutput)
+{
+	if (!mVertices.empty())
+		transformPositionKernel(&mVertices.front().x, mVertices.size(), matrix);
+	refitBvh();
+	if (refreshOutput)
+	{
+		// every output position is a copy of a vertex so gets the same result
+		transformPositionKernel(mVertexArray.data(), mVertexArray.size() / 3, matrix);
+		refreshLocalBoundingBox(); // before the interleaved data as positions may be quantized to it
+		refreshInterleavedData();
+		refreshSubmeshBounds();
+	}
+	else
+		refreshLocalBoundingBox();
 }
 
-void Objex::refreshLocalBoundingBox()
+void Objex::transformNormals(const float matrix[9], const bool normalize, const bool refreshOutput)
 {
-	mLocalBoundingBox.left = mVertices[0].x;
-	mLocalBoundingBox.right = mVertices[0].x;
-	mLocalBoundingBox.top = mVertices[0].y;
-	mLocalBoundingBox.bottom = mVertices[0].y;
-	mLocalBoundingBox.front = mVertices[0].z;
-	mLocalBoundingBox.back = mVertices[0].z;
-	for (auto vertex : mVertices)
+	if (!mNormals.empty())
+		transformDirectionKernel(&mNormals.front().x, mNormals.size(), matrix, normalize);
+	if (!refreshOutput)
+		return;
+
+	// output normals that are the default (from faces without normals) must stay as the default so the output is recreated instead of transformed
+	// without source data, the output can only be transformed (including any default normals) and tangents are transformed as directions
+	if (!mHasSourceData || (!mNormals.empty() && (std::find(mFaceNormalIndices.begin(), mFaceNormalIndices.end(), -1) == mFaceNormalIndices.end())))
 	{
-		if (vertex.x < mLocalBoundingBox.left)
-			mLocalBoundingBox.left = vertex.x;
-		if (vertex.x > mLocalBoundingBox.right)
-			mLocalBoundingBox.right = vertex.x;
-		if (vertex.y > mLocalBoundingBox.top)
-			mLocalBoundingBox.top = vertex.y;
-		if (vertex.y < mLocalBoundingBox.bottom)
-			mLocalBoundingBox.bottom = vertex.y;
-		if (vertex.z > mLocalBoundingBox.front)
-			mLocalBoundingBox.front = vertex.z;
-		if (vertex.z < mLocalBoundingBox.back)
-			mLocalBoundingBox.back = vertex.z;
+		transformDirectionKernel(mNormalArray.data(), mNormalArray.size() / 3, matrix, normalize);
+		if (mHasSourceData)
+			refreshTangentData();
+		else
+		{
+			for (std::size_t tangent{ 0u }; tangent < mTangentArray.size(); tangent += 4)
+				transformDirectionKernel(&mTangentArray[tangent], 1u, matrix, true);
+		}
+		refreshInterleavedData();
 	}
+	else
+		refreshData();
+}
+
+void Objex::includeInLocalBoundingBox(const Vertex& vertex)
+{
+	mLocalBoundingBox.left = std::min(mLocalBoundingBox.left, vertex.x);
+	mLocalBoundingBox.right = std::max(mLocalBoundingBox.right, vertex.x);
+	mLocalBoundingBox.bottom = std::min(mLocalBoundingBox.bottom, vertex.y);
+	mLocalBoundingBox.top = std::max(mLocalBoundingBox.top, vertex.y);
+	mLocalBoundingBox.back = std::min(mLocalBoundingBox.back, vertex.z);
+	mLocalBoundingBox.front = std::max(mLocalBoundingBox.front, vertex.z);
 	mLocalBoundingBox.width = mLocalBoundingBox.right - mLocalBoundingBox.left;
 	mLocalBoundingBox.height = mLocalBoundingBox.top - mLocalBoundingBox.bottom;
 	mLocalBoundingBox.depth = mLocalBoundingBox.front - mLocalBoundingBox.back;
@@ -4,7 +4,7 @@
 /**********************************
 **                               **
 **             OBJEX             **
-**             v0.2              **
+**             v0.3              **
 **                               **
 ** by Hapax                      **
 ** (http:://github.com/hapaxia)  **
@@ -23,14 +23,14 @@ CURRENTLY IMPORTS:
 
 [x] geometry vertices (faces with multiple triangles - all triangles use the face's first vertex and the previous triangle's last vertex)
 [x] normal vertices (fully imported but untested with lighting)
-[x] texture vertices (fully imported but untested with any materials - these aren't imported yet)
+[x] texture vertices (fully imported but untested with any materials)
 
-[ ] .MTL file
+[x] .MTL file (colours, shininess, opacity and the diffuse texture's filename)
 [ ] files referenced inside .MTL file
 
-[ ] object groups
+[x] object groups (each "g" and "o" line is a single name)
 [ ] shading groups
-[ ] materials
+[x] materials
 [ ] texture images
 
 
@@ -44,8 +44,24 @@ DOES NOT IMPORT:
 
 NOTES:
  - now also supports relative vertex indexing e.g. "f -4 -3 -2 -1"
- - manipulation of data requires recreation of the entire object and is therefore very slow and not intended for use with animation
- - outputs using "clog" (for information) and "cerr" (for errors)
+ - files are memory-mapped (or streamed in large blocks) and parsed directly from the bytes; no copy of the file's lines is kept
+ - a binary cache of the loaded data can be written and used instead of parsing on later loads (see LoadOptions)
+ - parsing can use multiple threads (see LoadOptions); relative indices are fixed up when the threads' results are merged
+ - output is either an expanded triangle list (default) or indexed (see OutputOptions), where shared vertices are stored once
+ - indexed output can be optimized for the vertex cache, overdraw and vertex fetch (see OutputOptions and getVertexCacheStatistics())
+ - normals can be generated (flat, or smooth with a crease angle) for files without them and tangents can be output (see NormalOptions and OutputOptions)
+ - an interleaved array (single buffer, caller-chosen attribute order and formats) can also be output (see OutputOptions); it can be quantized (e.g. getCompactInterleavedLayout())
+ - simplified levels of detail (index arrays into the same vertices) can be created from indexed output (see createLevelsOfDetail())
+ - triangles are output grouped by material; viewSubmeshes() gives the part of the output (and its bounds) for each material so each can be drawn with one call
+ - triangles can also be output in clusters of nearby faces with their own bounds and normal cone (see OutputOptions and viewClusters()) to cull them before drawing
+ - transformations (scale, translate, rotate, matrix) are applied directly to the output (using SSE where available)
+ - a bvh of the triangles can be built for ray casts, box queries and nearest points (see buildBvh()); it is refitted (not rebuilt) when vertices change
+ - manipulation of vertices, normals and texture vertices can be refreshed incrementally (refreshChangedData()); manipulation of faces requires recreation of the entire object
+ - static assets can be loaded render-only (see LoadOptions::keepSourceData), keeping only the output; getMemoryUsage() reports what each part uses
+ - files can be loaded on another thread (loadFromFileAsync()) or many at once on a pool of threads (BatchLoader); both can be cancelled
+ - objects using the same file can share one loaded mesh (Registry), each getting its own copy only once it changes it (Instance)
+ - errors are output using "cerr"; information (progress and counts) is only output using "clog" if LoadOptions::logInformation is set
+ - loading can report progress (LoadOptions::progressCallback) and getLoadStats() gives the time taken by each phase, element counts and peak memory
  - there are a number of possible errors that can occur if used incorrectly and they are not prepared for
  - the colour creation is not strictly required and may be removed or bypassed
 
@@ -63,44 +79,401 @@ NOTES:
 #include <fstream>
 #include <sstream>
 #include <sys/stat.h> // for filesize (for loading progress)
+#include <cstddef>
+#include <limits>
+#include <atomic>
+#include <memory>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <deque>
+#include <unordered_map>
 
 #include <iostream>
 
-// Objex (v0.2)
+// Objex (v0.3)
 class Objex
 {
 public:
+	// read-only access to elements stored inside Objex without copying them. only valid until the Objex is loaded again or its elements are added/removed
+	template <class T>
+	class ArrayView
+	{
+	public:
+		ArrayView(const T* data, std::size_t size) : m_data(data), m_size(size) { }
+		const T* begin() const { return m_data; }
+		const T* end() const { return m_data + m_size; }
+		const T* data() const { return m_data; }
+		std::size_t size() const { return m_size; }
+		bool empty() const { return m_size == 0u; }
+		const T& operator[](std::size_t index) const { return m_data[index]; }
+
+	private:
+		const T* m_data;
+		std::size_t m_size;
+	};
+
+	enum class FileAccess
+	{
+		MemoryMapped, // file is mapped into memory and parsed in place (falls back to Buffered if mapping fails)
+		Buffered // file is read and parsed in large blocks; only one block is held in memory at a time
+	};
+	struct NormalOptions // see generateNormals()
+	{
+		bool smooth{ true }; // false gives every corner of a face the face's (flat) normal
+		float creaseAngle{ 180.f }; // in degrees. a smooth normal only includes faces that meet the corner's face at no more than this angle (180 includes every face at the vertex)
+		bool weightByAngle{ true }; // each face's contribution to a smooth normal is weighted by its angle at the vertex
+		bool weightByArea{ true }; // each face's contribution to a smooth normal is weighted by its area
+		unsigned int numberOfThreads{ 1u }; // 0 uses all hardware threads. result is identical for any number of threads
+	};
+	struct LoadProgress // see LoadOptions::progressCallback
+	{
+		unsigned long long bytesProcessed;
+		unsigned long long totalBytes;
+		unsigned int linesProcessed;
+	};
+	struct LoadOptions
+	{
+		FileAccess fileAccess{ FileAccess::MemoryMapped };
+		unsigned int numberOfThreads{ 1u }; // threads used to parse (0 uses all hardware threads). result is identical for any number of threads
+		bool useCache{ false }; // load from a binary cache file if it matches the .obj file's size and modification time. otherwise, load the .obj file and (re)write the cache
+		std::string cacheFilename; // empty uses the .obj filename with ".objexcache" appended
+		bool generateMissingNormals{ false }; // if the file has no normals ("vn"), they are generated with normalOptions
+		NormalOptions normalOptions;
+		bool keepSourceData{ true }; // false releases the vertices, normals, texture vertices, faces and lines once the output is created (render-only). see hasSourceData()
+		std::shared_ptr<std::atomic<bool>> cancel; // if set, loading stops (and fails) once it becomes true e.g. from another thread (see loadFromFileAsync())
+		std::function<void(const LoadProgress&)> progressCallback; // called (on the loading thread) after each block of the file is parsed
+		bool logInformation{ false }; // writes progress and counts to clog while loading (and information from later operations e.g. buildBvh()). errors are always written to cerr
+	};
+	struct LoadStats // of the last load (see getLoadStats()). times are in seconds
+	{
+		bool isFromCache{ false };
+		double readTime{ 0.0 }; // reading or mapping the file (or cache)
+		double parseTime{ 0.0 };
+		double normalTime{ 0.0 }; // generating missing normals
+		double outputTime{ 0.0 }; // creating the output (triangulation, indexing, optimizations etc.)
+		double colorTime{ 0.0 };
+		double materialTime{ 0.0 }; // loading material libraries
+		double cacheTime{ 0.0 }; // writing the cache
+		double totalTime{ 0.0 };
+		unsigned long long bytes{ 0u }; // of the .obj data (or the cache)
+		unsigned int lines{ 0u };
+		unsigned int vertices{ 0u };
+		unsigned int normals{ 0u };
+		unsigned int textureVertices{ 0u };
+		unsigned int faces{ 0u };
+		unsigned int triangles{ 0u };
+		unsigned int materials{ 0u };
+		std::size_t allocations{ 0u }; // times the element and face lists were (re)allocated while parsing. the output is allocated once at its final size
+		std::size_t peakMemory{ 0u }; // in bytes. the largest getMemoryUsage().total (plus memory used for parsing) during the load
+	};
+	enum class Attribute
+	{
+		Position,
+		Normal,
+		Texture,
+		Color,
+		Tangent
+	};
+	enum class ComponentType
+	{
+		Float, // GL_FLOAT
+		NormalizedByte, // GL_BYTE (normalized) - range of [-1, 1] e.g. normals
+		NormalizedUnsignedByte, // GL_UNSIGNED_BYTE (normalized) - range of [0, 1] e.g. colours
+		NormalizedShort, // GL_SHORT (normalized) - range of [-1, 1]
+		NormalizedUnsignedShort, // GL_UNSIGNED_SHORT (normalized) - range of [0, 1] e.g. positions relative to the bounding box
+		HalfFloat // GL_HALF_FLOAT e.g. texture coordinates
+	};
+	enum class Encoding
+	{
+		None,
+		BoundingBox, // positions only: relative to the local bounding box, in [0, 1] (or [-1, 1] for signed types). see getPositionDequantization()
+		Octahedral // normals and tangents: the direction is folded into 2 components in [-1, 1] (mapped to [0, 1] for unsigned types). a third component is the tangent's handedness
+	};
+	struct AttributeFormat // fields left out of a brace list are zero i.e. ComponentType::Float and Encoding::None
+	{
+		Attribute attribute;
+		unsigned int numberOfComponents; // 1 to 4. components that are not available are 0 (except the fourth, which is 1)
+		ComponentType componentType;
+		Encoding encoding;
+	};
+	struct OutputOptions
+	{
+		bool indexed{ false }; // each unique vertex (position, texture and normal) is stored once and triangles are drawn from indexData (glDrawElements) instead of from the arrays in order (glDrawArrays)
+		std::vector<AttributeFormat> interleavedLayout; // attributes (in order) of each vertex in interleavedData. empty means no interleaved data is created
+		unsigned int interleavedStrideAlignment{ 4u }; // stride is rounded up to a multiple of this. each attribute always starts on a multiple of 4 bytes
+		unsigned int numberOfThreads{ 1u }; // threads used to create (non-indexed) output and tangents (0 uses all hardware threads). result is identical for any number of threads
+		bool tangents{ false }; // creates tangentData from the texture coordinates and normals (MikkTSpace-style). vertices without texture coordinates get a tangent perpendicular to their normal
+
+		// optimizations of indexed output (ignored otherwise). triangles are only reordered within each material so submeshes are unchanged
+		bool optimizeVertexCache{ false }; // reorders triangles so that transformed vertices are reused more (Forsyth's algorithm)
+		bool optimizeOverdraw{ false }; // after optimizing for the vertex cache, draws clusters of triangles that face outwards first (so more of the hidden ones are rejected by the depth test)
+		bool optimizeVertexFetch{ false }; // numbers vertices in the order they are first used so that vertex data is read sequentially
+		unsigned int vertexCacheSize{ 16u }; // entries in the (FIFO) post-transform vertex cache that is optimized for and simulated by getVertexCacheStatistics()
+
+		// clusters of nearby faces for culling (see viewClusters()). faces are reordered within each material so submeshes are unchanged. indexed output is then only optimized within each cluster
+		bool clusters{ false };
+		unsigned int maximumClusterVertices{ 64u }; // unique vertices when indexed (otherwise, three per triangle). a single face with more is a cluster on its own
+		unsigned int maximumClusterTriangles{ 124u };
+	};
+	struct VertexCacheStatistics // of drawing the output with a simulated post-transform vertex cache. non-indexed output transforms every corner
+	{
+		float acmr{ 0.f }; // average cache miss ratio: vertices transformed per triangle (3 is the worst; about 0.5 is ideal for large, regular meshes)
+		float atvr{ 0.f }; // average transformed vertex ratio: vertices transformed per vertex (1 is ideal)
+	};
+
 	GLfloat* vertexData{ nullptr };
 	GLfloat* normalData{ nullptr };
 	GLfloat* textureData{ nullptr };
 	GLfloat* colorData{ nullptr };
+	GLfloat* tangentData{ nullptr }; // only used when tangents are output. stride is 4: direction (x, y, z) and handedness (w, 1 or -1) so bitangent = w * cross(normal, tangent)
+	GLvoid* indexData{ nullptr }; // only used with indexed output. type is given by getIndexType()
+	GLvoid* interleavedData{ nullptr }; // only used when an interleaved layout is set. see getInterleavedStride() and getInterleavedOffset()
 
 	struct Vertex
 	{
 		float x, y, z;
 	};
-	struct Face
+	struct Face // used to set/get a face (faces are stored together internally). index of -1 means none (default)
 	{
 		std::vector<int> vertexIndices;
 		std::vector<int> normalIndices;
 		std::vector<int> textureIndices;
 	};
+	struct FaceView
+	{
+		ArrayView<int> vertexIndices;
+		ArrayView<int> normalIndices;
+		ArrayView<int> textureIndices;
+	};
 	struct Box
 	{
 		float left{ 0.f }, right{ 0.f }, top{ 0.f }, bottom{ 0.f }, front{ 0.f }, back{ 0.f }, width{ 0.f }, height{ 0.f }, depth{ 0.f };
 	};
+	struct Dequantization // position = offset + scale * value (per axis), where value is the component as read by the GPU (normalized)
+	{
+		Vertex scale;
+		Vertex offset;
+	};
+	struct ByteRange
+	{
+		std::size_t offset, size;
+	};
+	struct Material // from a material library (.mtl). materials that are used but not defined in any library only have a name
+	{
+		std::string name;
+		Vertex ambient{ 0.2f, 0.2f, 0.2f }; // Ka
+		Vertex diffuse{ 0.8f, 0.8f, 0.8f }; // Kd
+		Vertex specular{ 0.f, 0.f, 0.f }; // Ks
+		float shininess{ 0.f }; // Ns
+		float opacity{ 1.f }; // d (or 1 - Tr)
+		std::string diffuseTexture; // map_Kd (as written in the library)
+		bool isDefined{ false };
+	};
+	struct Submesh // consecutive triangles in the output that use the same material
+	{
+		int material; // position in viewMaterials(). -1 for faces without a material
+		unsigned int first; // first vertex (or first index if output is indexed)
+		unsigned int count; // number of vertices (or indices if output is indexed)
+		Box localBoundingBox;
+	};
+	struct Cluster // consecutive triangles in the output (within one submesh) that are close together, so each can be culled before drawing
+	{
+		int material;
+		unsigned int first; // first vertex (or first index if output is indexed)
+		unsigned int count; // number of vertices (or indices if output is indexed)
+		Box localBoundingBox;
+		Vertex center; // of the bounding sphere
+		float radius;
+		Vertex coneApex; // every triangle faces away (by its winding) from a camera for which dot(normalize(coneApex - cameraPosition), coneAxis) >= coneCutoff
+		Vertex coneAxis;
+		float coneCutoff; // more than 1 if the triangles face too many directions to be culled
+	};
+	struct LevelOfDetailTarget // a level is simplified until it has no more than numberOfTriangles or until simplifying further would exceed maximumError
+	{
+		unsigned int numberOfTriangles{ 0u };
+		float maximumError{ std::numeric_limits<float>::max() }; // approximate distance from the original surface (in the mesh's units)
+	};
+	struct LevelOfDetail // a simplified version of indexed output. it uses the same vertex arrays (vertexData etc.) and index type
+	{
+		const GLvoid* indexData;
+		unsigned int numberOfIndices;
+		float error; // approximate distance of the simplified surface from the original
+		ArrayView<Submesh> submeshes;
+	};
+	struct BvhOptions // see buildBvh()
+	{
+		unsigned int maximumTrianglesPerLeaf{ 4u }; // nodes with more triangles are always split (unless their triangles' centres are all the same)
+		unsigned int numberOfThreads{ 1u }; // 0 uses all hardware threads. result is identical for any number of threads
+	};
+	struct RayHit
+	{
+		unsigned int face;
+		float distance; // along the ray, in multiples of the direction's length
+		Vertex point;
+	};
+	struct NearestPoint
+	{
+		unsigned int face;
+		float distance;
+		Vertex point;
+	};
+	struct MemoryUsage // in bytes (as allocated) of each part of the stored data
+	{
+		std::size_t elements{ 0u }; // vertices, normals and texture vertices
+		std::size_t faces{ 0u }; // face indices, materials, groups, objects and output order
+		std::size_t lines{ 0u }; // comment and unprocessed lines
+		std::size_t output{ 0u }; // vertexData, normalData, textureData, colorData and tangentData
+		std::size_t indices{ 0u }; // indexData and the corner each indexed vertex was created from
+		std::size_t interleaved{ 0u };
+		std::size_t levelsOfDetail{ 0u };
+		std::size_t bvh{ 0u };
+		std::size_t editing{ 0u }; // output vertices that use each element and changes waiting to be refreshed
+		std::size_t other{ 0u }; // materials, names and submeshes
+		std::size_t total{ 0u };
+	};
+	struct ChangedRanges // parts of each output array (in bytes) that were rewritten e.g. for glBufferSubData
+	{
+		std::vector<ByteRange> vertex;
+		std::vector<ByteRange> normal;
+		std::vector<ByteRange> texture;
+		std::vector<ByteRange> tangent;
+		std::vector<ByteRange> interleaved;
+	};
+
+	// loads many files on a fixed number of worker threads (each file is loaded by one thread). every added file gives one result, either through the callback or takeFinished()
+	class BatchLoader
+	{
+	public:
+		struct Result
+		{
+			std::size_t request; // as returned by add()
+			std::string filename;
+			std::unique_ptr<Objex> objex; // null if loading failed or was cancelled
+		};
+
+		explicit BatchLoader(unsigned int numberOfThreads = 0u); // 0 uses all hardware threads
+		~BatchLoader(); // cancels loads that have not finished and waits for the threads
+		BatchLoader(const BatchLoader&) = delete;
+		BatchLoader& operator=(const BatchLoader&) = delete;
+
+		std::size_t add(const std::string& filename);
+		std::size_t add(const std::string& filename, const LoadOptions& loadOptions);
+		std::size_t add(const std::string& filename, const LoadOptions& loadOptions, const OutputOptions& outputOptions); // loadOptions.cancel is replaced (see cancel())
+		void setCallback(std::function<void(Result&&)> callback); // called on a worker thread for each finished load (instead of queuing it for takeFinished()). set before adding files
+		std::vector<Result> takeFinished(); // results queued since the last call. does not wait
+		void wait(); // until every added file has finished
+		void cancel(); // stops running loads and fails those that have not started. files added afterwards are loaded as usual
+		std::size_t getNumberOfUnfinished() const;
+
+	private:
+		struct Request
+		{
+			std::size_t number;
+			std::string filename;
+			LoadOptions loadOptions;
+			OutputOptions outputOptions;
+		};
+
+		std::vector<std::thread> mThreads;
+		std::deque<Request> mRequests;
+		std::vector<Result> mFinished;
+		std::function<void(Result&&)> mCallback;
+		std::shared_ptr<std::atomic<bool>> mCancel; // given to every load added since the last cancel()
+		std::size_t mNumberOfRequests{ 0u };
+		std::size_t mNumberOfUnfinished{ 0u };
+		bool mIsStopping{ false };
+		mutable std::mutex mMutex;
+		std::condition_variable mRequestAdded;
+		std::condition_variable mRequestFinished;
+
+		void work();
+	};
+
+	// shares loaded meshes between objects that use the same file: loading a file that is already loaded (with the same options, and not changed since) gives the same mesh instead of loading it again
+	// a mesh stays shared while anything uses it. see Instance for objects that may need to change their mesh
+	// the output arrays of a shared mesh (vertexData etc.) must only be read: they are not const but writing to them would change the mesh for everything that shares it, bypassing Instance's copy-on-write
+	class Registry
+	{
+	public:
+		static Registry& getGlobal(); // shared by the whole process
+
+		std::shared_ptr<const Objex> load(const std::string& filename); // null if loading failed
+		std::shared_ptr<const Objex> load(const std::string& filename, const LoadOptions& loadOptions);
+		std::shared_ptr<const Objex> load(const std::string& filename, const LoadOptions& loadOptions, const OutputOptions& outputOptions);
+		std::size_t getNumberOfMeshes() const; // that are loaded and still used
+		void clear(); // meshes already loaded are kept by whatever uses them but are no longer given to later loads
+
+	private:
+		std::unordered_map<std::string, std::weak_ptr<const Objex>> mMeshes; // by canonical path, file size and modification time, and the options that affect the result
+		mutable std::mutex mMutex;
+	};
+
+	// an object that draws a (usually shared) mesh. the mesh is copied the first time the object needs to change it (copy-on-write) so other objects using it are not affected
+	class Instance
+	{
+	public:
+		explicit Instance(std::shared_ptr<const Objex> mesh); // e.g. from Registry::load(). null (e.g. a failed load) gives an object without a mesh
+		Instance(const Instance& other); // shares the mesh unless other has its own copy, which is copied
+		Instance(Instance&& other);
+		~Instance();
+		Instance& operator=(const Instance& other);
+		Instance& operator=(Instance&& other);
+
+		const Objex& get() const; // for drawing and queries. an empty mesh if this object has none
+		const Objex* operator->() const;
+		Objex& edit(); // for "set"s, transformations, refreshes etc. gives this object its own copy of the mesh first if it is shared (or a new empty mesh if it has none)
+		bool isShared() const;
+		bool hasMesh() const; // false if constructed from null or moved from
+
+	private:
+		std::shared_ptr<const Objex> mSharedMesh;
+		std::unique_ptr<Objex> mOwnMesh;
+	};
 
 	Objex();
+	Objex(Objex&& other); // the data pointers (vertexData etc.) stay valid as the arrays are moved, not copied. other is left empty (as if just constructed)
+	Objex& operator=(Objex&& other);
+	Objex& operator=(const Objex& other) = delete; // use clone()
+	std::unique_ptr<Objex> clone() const; // a separate copy of everything (its data pointers point to its own arrays)
 
 	void refreshData();
+	ChangedRanges refreshChangedData(); // rewrites only the output affected by "set"s since the last refresh (changing a face refreshes everything)
 	bool loadFromFile(const std::string& filename);
+	bool loadFromFile(const std::string& filename, const LoadOptions& options);
+	std::future<bool> loadFromFileAsync(const std::string& filename); // loads on another thread. the Objex must not be used until the future is ready
+	std::future<bool> loadFromFileAsync(const std::string& filename, const LoadOptions& options); // set options.cancel to be able to stop it
+	bool loadFromMemory(const char* data, std::size_t size); // data is the contents of an .obj file (does not need to be null-terminated)
+	bool loadFromMemory(const char* data, std::size_t size, const LoadOptions& options);
+	bool loadMaterialLibrary(const std::string& filename); // adds the materials defined in an .mtl file (or completes ones already used). libraries named in an .obj file ("mtllib") are loaded by loadFromFile()
+	void setOutputOptions(const OutputOptions& options); // refreshes data if already loaded
+	OutputOptions getOutputOptions() const;
 	void scale(float scale);
 
+	// transformations are applied to the vertices (and normals) and, if refreshOutput is true, directly to the output without recreating it
+	// matrices are column-major (as OpenGL). the bottom row of a 4x4 matrix is ignored (affine only)
+	void translate(const Vertex& offset, bool refreshOutput = true);
+	void rotate(float angle, const Vertex& axis, bool refreshOutput = true); // angle in degrees, anti-clockwise around axis (as glRotatef)
+	void applyMatrix(const float matrix[16], bool refreshOutput = true); // normals are transformed by the inverse transpose and normalized
+	void applyNormalMatrix(const float matrix[9], bool refreshOutput = true); // transforms normals only (they are not normalized)
+
 	void setVertex(unsigned int vertexNumber, Vertex& vertexData);
 	void setVertexNormal(unsigned int vertexNormalNumber, Vertex& vertexNormalData);
 	void setTextureVertex(unsigned int textureVertexNumber, Vertex& textureVertexData);
 	void setFace(unsigned int faceNumber, Face& faceData);
 
+	// set a consecutive range, starting at the "first" element
+	void setVertices(unsigned int firstVertexNumber, const Vertex* vertices, std::size_t numberOfVertices);
+	void setVertexNormals(unsigned int firstVertexNormalNumber, const Vertex* vertexNormals, std::size_t numberOfVertexNormals);
+	void setTextureVertices(unsigned int firstTextureVertexNumber, const Vertex* textureVertices, std::size_t numberOfTextureVertices);
+	void setFaces(unsigned int firstFaceNumber, const Face* faces, std::size_t numberOfFaces);
+
+	// "set"s between these are applied to the output (and bounding box) together when committed
+	void beginEdit();
+	ChangedRanges commitEdit();
+
 	Vertex getVertex(unsigned int vertexNumber);
 	Vertex getVertexNormal(unsigned int vertexNormalNumber);
 	Vertex getTextureVertex(unsigned int textureVertexNumber);
@@ -111,44 +484,212 @@ public:
 	std::vector<Vertex> getAllTextureVertices();
 	std::vector<Face> getAllFaces();
 
-	Vertex getLocalBoundingBoxCenter();
-	Box getLocalBoundingBox();
-
-	unsigned int getNumberOfVertices();
-	unsigned int getNumberOfTriangles();
+	// as above but without copying
+	const Vertex& viewVertex(unsigned int vertexNumber) const;
+	const Vertex& viewVertexNormal(unsigned int vertexNormalNumber) const;
+	const Vertex& viewTextureVertex(unsigned int textureVertexNumber) const;
+	FaceView viewFace(unsigned int faceNumber) const;
+	ArrayView<Vertex> viewAllVertices() const;
+	ArrayView<Vertex> viewAllVertexNormals() const;
+	ArrayView<Vertex> viewAllTextureVertices() const;
+	unsigned int getNumberOfFaces() const;
+
+	// materials, groups and objects. a face's material/group/object is its position in the list (-1 if none)
+	ArrayView<Material> viewMaterials() const;
+	ArrayView<std::string> viewGroupNames() const;
+	ArrayView<std::string> viewObjectNames() const;
+	ArrayView<std::string> viewMaterialLibraries() const; // as named in the .obj file
+	int getFaceMaterial(unsigned int faceNumber) const;
+	int getFaceGroup(unsigned int faceNumber) const;
+	int getFaceObject(unsigned int faceNumber) const;
+	ArrayView<Submesh> viewSubmeshes() const; // in output order. bounds are of the output
+	ArrayView<Cluster> viewClusters() const; // in output order. empty unless clusters are output (see OutputOptions). bounds are of the output
+
+	Vertex getLocalBoundingBoxCenter() const;
+	Box getLocalBoundingBox() const;
+
+	unsigned int getNumberOfVertices() const; // with indexed output, this is the number of unique vertices
+	unsigned int getNumberOfTriangles() const;
+	unsigned int getNumberOfIndices() const; // zero unless output is indexed
+	GLenum getIndexType() const; // GL_UNSIGNED_SHORT if the number of vertices allows it, otherwise GL_UNSIGNED_INT
+	unsigned int getInterleavedStride() const; // in bytes
+	int getInterleavedOffset(Attribute attribute) const; // in bytes. -1 if the attribute is not in the interleaved layout
+	Dequantization getPositionDequantization() const; // of interleaved positions with bounding box encoding (scale of 1 and offset of 0 otherwise). changes whenever the bounding box does
+	static std::vector<AttributeFormat> getCompactInterleavedLayout(); // 20 bytes per vertex: 16-bit positions (bounding box), 16-bit octahedral normals, half-float texture coordinates and 8-bit colours
+	VertexCacheStatistics getVertexCacheStatistics() const; // of the current output
+	VertexCacheStatistics getUnoptimizedVertexCacheStatistics() const; // of the output before it was last optimized (the same as the current output if it was not optimized)
+	MemoryUsage getMemoryUsage() const;
+	const LoadStats& getLoadStats() const;
+
+	// without source data (see LoadOptions::keepSourceData) the output can still be drawn and transformed but it cannot be recreated (e.g. by setOutputOptions() or generateNormals()) or edited
+	// the element and face lists are empty, levels of detail and the bvh cannot be created and transformed normals include the default normals of faces without them
+	bool hasSourceData() const;
+
+	// levels of detail are simplified from indexed output by collapsing edges (with quadric error metrics). each level continues from the one before so targets should decrease
+	// vertices on UV/normal seams, material boundaries and open borders are kept. levels are removed when the output is recreated
+	// normals are generated from the faces (replacing any existing normals) and the output is recreated. they are not updated automatically if vertices change
+	void generateNormals();
+	void generateNormals(const NormalOptions& options);
+
+	bool createLevelsOfDetail(const std::vector<LevelOfDetailTarget>& targets); // requires indexed output
+	unsigned int getNumberOfLevelsOfDetail() const;
+	LevelOfDetail getLevelOfDetail(unsigned int level) const; // level 0 is the first simplified level
+
+	// a bounding volume hierarchy of the faces' triangles (in local coordinates, as stored) for picking and other spatial queries
+	// it is refitted when changed vertices are refreshed (or transformed) and rebuilt when changed faces are refreshed. queries require it to be built
+	void buildBvh();
+	void buildBvh(const BvhOptions& options);
+	void refitBvh(); // updates the bounds for vertices that were changed but not refreshed
+	bool hasBvh() const;
+	bool castRay(const Vertex& origin, const Vertex& direction, RayHit& hit, float maximumDistance = std::numeric_limits<float>::max()) const; // closest hit (triangles are hit from either side)
+	bool isRayBlocked(const Vertex& origin, const Vertex& direction, float maximumDistance = std::numeric_limits<float>::max()) const; // any hit (faster than castRay)
+	std::vector<unsigned int> findFacesInBox(const Box& box) const; // faces with a triangle overlapping the box (in increasing order). only the box's edges are used (not its sizes)
+	bool findNearestPoint(const Vertex& point, NearestPoint& nearest, float maximumDistance = std::numeric_limits<float>::max()) const; // closest point on any triangle
 
 	void randomizeColorData();
 
 	// retrieve some of the "lines" from .obj file
 	std::vector<std::string> getCommentLines();
 	std::vector<std::string> getUnprocessedLines();
+	ArrayView<std::string> viewCommentLines() const;
+	ArrayView<std::string> viewUnprocessedLines() const;
 
 private:
+	Objex(const Objex& other); // copies the data pointers too. see clone()
 
 	std::vector<GLfloat> mVertexArray; // stride is 3 i.e. 3 coordinates per vertex (no other information is interleaved e.g. colour/texture, normal)
 	std::vector<GLfloat> mNormalArray; // stride is 3 i.e. 3 coordinates per vertex normal (no other information is interleaved e.g. colour/texture, geometry)
 	std::vector<GLfloat> mTextureArray; // stride is 3 i.e. 3 coordinates per vertex normal (no other information is interleaved e.g. geometry, normal, colour)
 	std::vector<GLfloat> mColorArray; // random colours for testing - easier to see (when no shading is applied)
+	std::vector<GLushort> mShortIndexArray; // indices for indexed output (when there are few enough vertices)
+	std::vector<GLuint> mIndexArray; // indices for indexed output (when there are too many vertices for mShortIndexArray)
+	std::vector<unsigned int> mIndexedVertexCorners; // face corner (position in the face index lists) that each vertex of indexed output was created from
+	VertexCacheStatistics mUnoptimizedVertexCacheStatistics;
+	std::vector<GLfloat> mTangentArray; // stride is 4 (direction and handedness). empty unless tangents are output
+	std::vector<unsigned char> mInterleavedArray; // all attributes of each vertex together, as described by the interleaved layout
+	unsigned int mInterleavedStride{ 0u };
+	int mInterleavedOffsets[5]{ -1, -1, -1, -1, -1 }; // in order of Attribute
+	Dequantization mPositionDequantization{ { 1.f, 1.f, 1.f }, { 0.f, 0.f, 0.f } }; // that the interleaved positions were written with
 
 	std::vector<Vertex> mVertices;
 	std::vector<Vertex> mNormals;
 	std::vector<Vertex> mTextures;
-	std::vector<Face> mFaces;
 
-	Box mLocalBoundingBox;
+	// faces are stored together: the corners of face i are [mFaceFirstCorners[i], mFaceFirstCorners[i + 1]) of the index lists (so there is one more "first corner" than faces)
+	// every corner has all three indices; normal and texture indices of -1 mean the face does not have them
+	std::vector<unsigned int> mFaceFirstCorners{ 0u };
+	std::vector<int> mFaceVertexIndices;
+	std::vector<int> mFaceNormalIndices;
+	std::vector<int> mFaceTextureIndices;
+
+	// material, group and object of each face (-1 is none)
+	std::vector<int> mFaceMaterials;
+	std::vector<int> mFaceGroups;
+	std::vector<int> mFaceObjects;
+	std::vector<Material> mMaterials;
+	std::vector<std::string> mGroupNames;
+	std::vector<std::string> mObjectNames;
+	std::vector<std::string> mMaterialLibraries;
+
+	std::vector<unsigned int> mFaceOrder; // faces in the order they are output (grouped by material)
+	std::vector<Submesh> mSubmeshes;
+	std::vector<unsigned int> mClusterFirstFaces; // position in mFaceOrder where each cluster starts (and where the last one ends)
+	std::vector<Cluster> mClusters;
+
+	struct LevelOfDetailData
+	{
+		std::vector<GLushort> shortIndices; // used if the output's indices are 16-bit
+		std::vector<GLuint> indices;
+		std::vector<Submesh> submeshes;
+		float error;
+	};
+	std::vector<LevelOfDetailData> mLevelsOfDetail;
+
+	// bvh nodes are depth-first: an internal node's first child follows it and its second child is at secondChildOrFirstTriangle
+	struct BvhNode
+	{
+		float minimum[3];
+		unsigned int secondChildOrFirstTriangle;
+		float maximum[3];
+		unsigned int numberOfTriangles; // 0 for internal nodes
+	};
+	struct BvhTriangle
+	{
+		int vertices[3];
+		unsigned int face;
+	};
+	std::vector<BvhNode> mBvhNodes;
+	std::vector<BvhTriangle> mBvhTriangles; // in order of leaf
+	BvhOptions mBvhOptions;
+
+	mutable Box mLocalBoundingBox; // refreshed when requested if outdated (a shared mesh is refreshed before it is shared, see Registry)
+	mutable bool mIsLocalBoundingBoxOutdated{ false };
+
+	// changes since the last refresh
+	std::vector<unsigned int> mChangedVertices;
+	std::vector<unsigned int> mChangedNormals;
+	std::vector<unsigned int> mChangedTextures;
+	bool mAreFacesChanged{ false };
+	bool mIsEditing{ false };
+	bool mHasSourceData{ true };
+
+	// output vertices that use each vertex/normal/texture vertex (CSR: output vertices of element i are in [first[i], first[i + 1]) of the list). built when first needed after each refresh
+	struct OutputVertexMap
+	{
+		std::vector<unsigned int> first;
+		std::vector<unsigned int> outputVertices;
+	};
+	OutputVertexMap mVertexOutputMap;
+	OutputVertexMap mNormalOutputMap;
+	OutputVertexMap mTextureOutputMap;
 
 	std::vector<std::string> mCommentLines;
 	std::vector<std::string> mUnprocessedLines;
 
-	std::string trimWhitespaceLeft(std::string string);
-	std::string trimWhitespaceRight(std::string string);
-	std::string trimWhitespace(const std::string& string);
-	unsigned int getTokens(const std::string& line, std::vector<std::string>& tokens);
-	void addTokensToVertexVector(const std::vector<std::string>& tokens, std::vector<Vertex>& vertices);
-
-	void transferFaceToArray(const std::vector<int>& indices, const std::vector<Vertex>& vertices, std::vector<GLfloat>& destinationArray, const Vertex& defaultVertex = { 0.f, 0.f, 0.f });
-	void refreshLocalBoundingBox();
-	bool parse(const std::vector<std::string>& lines);
+	LoadOptions mLoadOptions;
+	LoadStats mLoadStats;
+	OutputOptions mOutputOptions;
+	unsigned int mNumberOfParsedLines{ 0u };
+
+	void clear();
+	bool loadFromObjFile(const std::string& filename, const LoadOptions& options);
+	bool parseMemory(const char* data, std::size_t size, const LoadOptions& options);
+	bool loadFromCacheFile(const std::string& cacheFilename, unsigned long long sourceSize, long long sourceModificationTime, const LoadOptions& options);
+	bool saveToCacheFile(const std::string& cacheFilename, unsigned long long sourceSize, long long sourceModificationTime);
+	struct ParseScratch;
+	bool parseBlock(const char* begin, const char* end, ParseScratch& scratch); // parses complete lines only (a final line without a newline is also complete)
+	bool finishLoad();
+	void releaseSourceData();
+	void refreshDataPointers();
+	void swapMembers(Objex& other); // every member (including the data pointers) so a new member must be added to it
+	void recordLoadCounts();
+	void recordPeakMemory(std::size_t temporaryMemory);
+	void loadMaterialLibraries(const std::string& directory);
+	void refreshFaceOrder();
+	void refreshClusterOrder();
+	void refreshSubmeshes();
+	void refreshSubmeshBounds();
+	void refreshIndexedData();
+	void optimizeIndexedData(const std::vector<std::size_t>& rangeFirstIndices);
+	void buildBvhNode(std::vector<BvhNode>& nodes, std::vector<unsigned int>& order, unsigned int first, unsigned int count, const std::vector<float>& triangleBounds, unsigned int depth, unsigned int taskDepth, std::vector<unsigned int>& taskNodes) const;
+	void generateNormalData(const NormalOptions& options);
+	void refreshTangentData();
+	void getOutputCorners(std::vector<unsigned int>& corners) const;
+	void refreshInterleavedData();
+	void writeInterleavedVertex(std::size_t vertexNumber);
+	Dequantization calculatePositionDequantization();
+	void clearChanges();
+	void storeFace(unsigned int faceNumber, const Face& face);
+	void changeVertex(unsigned int vertexNumber, const Vertex& vertexData);
+	void buildOutputVertexMaps();
+	void refreshChangedElements(std::vector<unsigned int>& changedElements, const std::vector<Vertex>& elements, const OutputVertexMap& outputMap, std::vector<GLfloat>& destinationArray, std::vector<unsigned int>& changedOutputVertices);
+
+	void transferFaceToArray(const int* indices, std::size_t numberOfIndices, const std::vector<Vertex>& vertices, GLfloat* destination, const Vertex& defaultVertex = { 0.f, 0.f, 0.f }); // destination must have space for all of the face's triangles
+	void refreshLocalBoundingBox() const;
+	std::size_t countTriangles() const;
+	void transformPositions(const float matrix[16], bool refreshOutput);
+	void transformNormals(const float matrix[9], bool normalize, bool refreshOutput);
+	void includeInLocalBoundingBox(const Vertex& vertex);
 
 	void createColorArray();
 };
@@ -0,0 +1,523 @@
+// headless benchmark of loading and manipulating generated .obj files. results are written as JSON
+// no window or OpenGL context is created (SFML/OpenGL.hpp is only needed for the GL types) e.g.
+//     g++ -std=c++14 -O2 -pthread -I<SFML include> benchmark.cpp Objex.cpp -o benchmark
+// usage: benchmark [--faces 10000,100000,1000000] [--runs 5] [--threads 1] [--directory .] [--output results.json] [--keep-files]
+// face counts of up to 50000000 are supported but need a few GB of disk space and memory
+
+#include "Objex.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream> // for errors
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif // NOMINMAX
+#include <windows.h>
+#include <psapi.h> // may need psapi.lib with older SDKs
+#else
+#include <sys/resource.h>
+#endif // _WIN32
+
+namespace
+{
+
+enum class Shape
+{
+	Grid, // a wavy plane
+	Sphere
+};
+
+struct MeshSpecification
+{
+	std::string name;
+	Shape shape;
+	unsigned long long targetFaces;
+	bool normals;
+	bool textures;
+	bool quads;
+	bool relativeIndices; // faces use negative (relative) indices
+};
+
+struct GeneratedMesh
+{
+	std::string filename;
+	unsigned long long faces{ 0u };
+	unsigned long long vertices{ 0u };
+	unsigned long long bytes{ 0u };
+};
+
+// writes the file in large blocks as the text is created
+class ObjWriter
+{
+public:
+	explicit ObjWriter(const std::string& filename)
+		: mFile(filename, std::ofstream::out | std::ofstream::binary | std::ofstream::trunc)
+	{
+		mBuffer.reserve(blockSize + 256u);
+	}
+	~ObjWriter()
+	{
+		flush();
+	}
+	bool isOpen() const
+	{
+		return mFile.is_open();
+	}
+	void writeElement(const char* keyword, const float x, const float y, const float z)
+	{
+		char text[96];
+		const int length{ std::snprintf(text, sizeof(text), "%s %.6f %.6f %.6f\n", keyword, x, y, z) };
+		append(text, length);
+	}
+	void writeTextureVertex(const float u, const float v)
+	{
+		char text[64];
+		const int length{ std::snprintf(text, sizeof(text), "vt %.6f %.6f\n", u, v) };
+		append(text, length);
+	}
+	// indices are one-based and, as there is one normal and texture vertex per vertex, are the same for each
+	void writeFace(const unsigned long long* indices, const unsigned int numberOfCorners, const unsigned long long numberOfVertices, const MeshSpecification& specification)
+	{
+		mBuffer += 'f';
+		for (unsigned int corner{ 0u }; corner < numberOfCorners; ++corner)
+		{
+			const long long index{ specification.relativeIndices ? static_cast<long long>(indices[corner]) - static_cast<long long>(numberOfVertices) - 1 : static_cast<long long>(indices[corner]) };
+			char text[80];
+			int length;
+			if (specification.normals && specification.textures)
+				length = std::snprintf(text, sizeof(text), " %lld/%lld/%lld", index, index, index);
+			else if (specification.normals)
+				length = std::snprintf(text, sizeof(text), " %lld//%lld", index, index);
+			else if (specification.textures)
+				length = std::snprintf(text, sizeof(text), " %lld/%lld", index, index);
+			else
+				length = std::snprintf(text, sizeof(text), " %lld", index);
+			mBuffer.append(text, length);
+		}
+		mBuffer += '\n';
+		if (mBuffer.size() >= blockSize)
+			flush();
+	}
+
+private:
+	static const std::size_t blockSize{ 4u * 1024u * 1024u };
+	std::ofstream mFile;
+	std::string mBuffer;
+
+	void append(const char* text, const int length)
+	{
+		mBuffer.append(text, length);
+		if (mBuffer.size() >= blockSize)
+			flush();
+	}
+	void flush()
+	{
+		mFile.write(mBuffer.data(), mBuffer.size());
+		mBuffer.clear();
+	}
+};
+
+// splits quads into two triangles unless quads are requested
+void writeQuad(ObjWriter& writer, const unsigned long long a, const unsigned long long b, const unsigned long long c, const unsigned long long d, const unsigned long long numberOfVertices, const MeshSpecification& specification, unsigned long long& faces)
+{
+	if (specification.quads)
+	{
+		const unsigned long long quad[4]{ a, b, c, d };
+		writer.writeFace(quad, 4u, numberOfVertices, specification);
+		++faces;
+		return;
+	}
+	const unsigned long long first[3]{ a, b, c };
+	const unsigned long long second[3]{ a, c, d };
+	writer.writeFace(first, 3u, numberOfVertices, specification);
+	writer.writeFace(second, 3u, numberOfVertices, specification);
+	faces += 2u;
+}
+
+void writeGrid(ObjWriter& writer, const MeshSpecification& specification, GeneratedMesh& mesh)
+{
+	const unsigned long long cells{ std::max(specification.quads ? specification.targetFaces : specification.targetFaces / 2u, 1ull) };
+	const unsigned long long columns{ std::max(static_cast<unsigned long long>(std::ceil(std::sqrt(static_cast<double>(cells)))), 1ull) };
+	const unsigned long long rows{ (cells + columns - 1u) / columns };
+	const float spacing{ 0.1f };
+	for (unsigned long long row{ 0u }; row <= rows; ++row)
+	{
+		for (unsigned long long column{ 0u }; column <= columns; ++column)
+		{
+			const float x{ column * spacing };
+			const float z{ row * spacing };
+			writer.writeElement("v", x, 0.25f * std::sin(x) * std::cos(z), z);
+			if (specification.normals)
+			{
+				// from the slopes of the height in x and z
+				const float slopeX{ 0.25f * std::cos(x) * std::cos(z) };
+				const float slopeZ{ -0.25f * std::sin(x) * std::sin(z) };
+				const float length{ std::sqrt(slopeX * slopeX + 1.f + slopeZ * slopeZ) };
+				writer.writeElement("vn", -slopeX / length, 1.f / length, -slopeZ / length);
+			}
+			if (specification.textures)
+				writer.writeTextureVertex(static_cast<float>(column) / columns, static_cast<float>(row) / rows);
+		}
+	}
+	mesh.vertices = (rows + 1u) * (columns + 1u);
+
+	// anti-clockwise when viewed from above
+	for (unsigned long long row{ 0u }; row < rows; ++row)
+	{
+		for (unsigned long long column{ 0u }; column < columns; ++column)
+		{
+			const unsigned long long first{ row * (columns + 1u) + column + 1u };
+			const unsigned long long next{ first + columns + 1u };
+			writeQuad(writer, first, next, next + 1u, first + 1u, mesh.vertices, specification, mesh.faces);
+		}
+	}
+}
+
+void writeSphere(ObjWriter& writer, const MeshSpecification& specification, GeneratedMesh& mesh)
+{
+	// triangles at the poles and quads (or pairs of triangles) between rings
+	const unsigned long long stacks{ std::max(static_cast<unsigned long long>(std::sqrt(static_cast<double>(specification.targetFaces) / (specification.quads ? 2.0 : 4.0))), 2ull) };
+	const unsigned long long slices{ stacks * 2u };
+	const double pi{ 3.14159265358979323846 };
+	auto writeVertex = [&](const float x, const float y, const float z, const float u, const float v)
+	{
+		writer.writeElement("v", x, y, z);
+		if (specification.normals)
+			writer.writeElement("vn", x, y, z);
+		if (specification.textures)
+			writer.writeTextureVertex(u, v);
+	};
+	writeVertex(0.f, 1.f, 0.f, 0.5f, 1.f);
+	for (unsigned long long stack{ 1u }; stack < stacks; ++stack)
+	{
+		const double polar{ pi * stack / stacks };
+		for (unsigned long long slice{ 0u }; slice < slices; ++slice)
+		{
+			const double azimuth{ 2.0 * pi * slice / slices };
+			writeVertex(static_cast<float>(std::sin(polar) * std::cos(azimuth)), static_cast<float>(std::cos(polar)), static_cast<float>(-std::sin(polar) * std::sin(azimuth)),
+				static_cast<float>(slice) / slices, 1.f - static_cast<float>(stack) / stacks);
+		}
+	}
+	writeVertex(0.f, -1.f, 0.f, 0.5f, 0.f);
+	mesh.vertices = 2u + (stacks - 1u) * slices;
+
+	// anti-clockwise when viewed from outside
+	auto ring = [&](const unsigned long long stack, const unsigned long long slice) { return 2u + (stack - 1u) * slices + slice % slices; };
+	const unsigned long long bottom{ mesh.vertices };
+	for (unsigned long long slice{ 0u }; slice < slices; ++slice)
+	{
+		const unsigned long long top[3]{ 1u, ring(1u, slice), ring(1u, slice + 1u) };
+		writer.writeFace(top, 3u, mesh.vertices, specification);
+		for (unsigned long long stack{ 1u }; stack < stacks - 1u; ++stack)
+			writeQuad(writer, ring(stack, slice), ring(stack + 1u, slice), ring(stack + 1u, slice + 1u), ring(stack, slice + 1u), mesh.vertices, specification, mesh.faces);
+		const unsigned long long bottomFace[3]{ bottom, ring(stacks - 1u, slice + 1u), ring(stacks - 1u, slice) };
+		writer.writeFace(bottomFace, 3u, mesh.vertices, specification);
+		mesh.faces += 2u;
+	}
+}
+
+bool generateMesh(const MeshSpecification& specification, const std::string& filename, GeneratedMesh& mesh)
+{
+	mesh = GeneratedMesh();
+	mesh.filename = filename;
+	{
+		ObjWriter writer(filename);
+		if (!writer.isOpen())
+			return false;
+		if (specification.shape == Shape::Grid)
+			writeGrid(writer, specification, mesh);
+		else
+			writeSphere(writer, specification, mesh);
+	}
+	std::ifstream file(filename, std::ifstream::in | std::ifstream::binary | std::ifstream::ate);
+	mesh.bytes = static_cast<unsigned long long>(file.tellg());
+	return file.is_open();
+}
+
+// in bytes. the largest amount of physical memory used by the process so far
+std::size_t getPeakResidentSetSize()
+{
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS counters;
+	if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+		return 0u;
+	return counters.PeakWorkingSetSize;
+#else
+	rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) != 0)
+		return 0u;
+#ifdef __APPLE__
+	return static_cast<std::size_t>(usage.ru_maxrss); // bytes
+#else
+	return static_cast<std::size_t>(usage.ru_maxrss) * 1024u; // kilobytes
+#endif // __APPLE__
+#endif // _WIN32
+}
+
+double getSeconds(const std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+struct Result
+{
+	std::string operation;
+	std::vector<double> seconds; // one per run
+	unsigned long long bytes; // processed by each run (zero if not applicable)
+	unsigned long long items; // processed by each run
+	std::string itemName; // e.g. "faces"
+};
+
+struct MeshResults
+{
+	std::string name;
+	GeneratedMesh mesh;
+	std::vector<Result> results;
+	std::size_t peakLoadMemory{ 0u }; // see Objex::LoadStats
+	std::size_t peakResidentSetSize{ 0u }; // of the process after this mesh
+};
+
+// nearest rank of sorted values
+double getPercentile(const std::vector<double>& sorted, const double percentile)
+{
+	if (sorted.empty())
+		return 0.0;
+	const std::size_t rank{ static_cast<std::size_t>(std::ceil(percentile / 100.0 * sorted.size())) };
+	return sorted[std::min(std::max(rank, std::size_t{ 1u }), sorted.size()) - 1u];
+}
+
+void writeResult(std::ostream& json, const Result& result)
+{
+	std::vector<double> sorted(result.seconds);
+	std::sort(sorted.begin(), sorted.end());
+	const double median{ getPercentile(sorted, 50.0) };
+	json << "{ \"operation\": \"" << result.operation << "\", \"runs\": " << sorted.size() << ", \"seconds\": { \"min\": " << getPercentile(sorted, 0.0) << ", \"p50\": " << median <<
+		", \"p90\": " << getPercentile(sorted, 90.0) << ", \"p99\": " << getPercentile(sorted, 99.0) << ", \"max\": " << getPercentile(sorted, 100.0) << " }";
+	if (median > 0.0)
+	{
+		if (result.bytes != 0u)
+			json << ", \"megabytesPerSecond\": " << result.bytes / (1024.0 * 1024.0) / median;
+		json << ", \"" << result.itemName << "PerSecond\": " << result.items / median;
+	}
+	json << " }";
+}
+
+void writeJson(std::ostream& json, const std::vector<MeshResults>& meshResults, const unsigned int runs, const unsigned int threads)
+{
+	json.precision(9);
+	json << "{\n\t\"runs\": " << runs << ",\n\t\"threads\": " << threads << ",\n\t\"meshes\": [";
+	for (std::size_t meshNumber{ 0u }; meshNumber < meshResults.size(); ++meshNumber)
+	{
+		const MeshResults& mesh(meshResults[meshNumber]);
+		json << ((meshNumber == 0u) ? "\n" : ",\n") << "\t\t{\n\t\t\t\"name\": \"" << mesh.name << "\",\n\t\t\t\"faces\": " << mesh.mesh.faces << ",\n\t\t\t\"vertices\": " << mesh.mesh.vertices <<
+			",\n\t\t\t\"bytes\": " << mesh.mesh.bytes << ",\n\t\t\t\"peakLoadMemoryBytes\": " << mesh.peakLoadMemory << ",\n\t\t\t\"peakResidentSetSizeBytes\": " << mesh.peakResidentSetSize << ",\n\t\t\t\"results\": [";
+		for (std::size_t resultNumber{ 0u }; resultNumber < mesh.results.size(); ++resultNumber)
+		{
+			json << ((resultNumber == 0u) ? "\n\t\t\t\t" : ",\n\t\t\t\t");
+			writeResult(json, mesh.results[resultNumber]);
+		}
+		json << "\n\t\t\t]\n\t\t}";
+	}
+	json << "\n\t],\n\t\"peakResidentSetSizeBytes\": " << getPeakResidentSetSize() << "\n}\n";
+}
+
+bool benchmarkMesh(const GeneratedMesh& mesh, const unsigned int runs, const unsigned int threads, MeshResults& meshResults)
+{
+	const unsigned long long faces{ mesh.faces };
+	Result mappedLoad{ "loadFromFile.memoryMapped", {}, mesh.bytes, faces, "faces" };
+	Result bufferedLoad{ "loadFromFile.buffered", {}, mesh.bytes, faces, "faces" };
+	Result parse{ "parse", {}, mesh.bytes, faces, "faces" }; // part of each memory-mapped load (see Objex::LoadStats)
+	Result memoryLoad{ "loadFromMemory", {}, mesh.bytes, faces, "faces" };
+	Result refresh{ "refreshData", {}, 0u, faces, "faces" };
+	Result scale{ "scale", {}, 0u, mesh.vertices, "vertices" };
+	Result setVertex{ "setVertex+refreshChangedData", {}, 0u, mesh.vertices, "vertices" };
+	Result bounds{ "getLocalBoundingBox", {}, 0u, mesh.vertices, "vertices" };
+
+	Objex::LoadOptions loadOptions;
+	loadOptions.numberOfThreads = threads;
+	for (unsigned int run{ 0u }; run < runs; ++run)
+	{
+		for (const Objex::FileAccess fileAccess : { Objex::FileAccess::MemoryMapped, Objex::FileAccess::Buffered })
+		{
+			Objex objex;
+			loadOptions.fileAccess = fileAccess;
+			const auto start = std::chrono::steady_clock::now();
+			if (!objex.loadFromFile(mesh.filename, loadOptions))
+			{
+				std::cerr << "Failed to load " << mesh.filename << std::endl;
+				return false;
+			}
+			const double seconds{ getSeconds(start) };
+			meshResults.peakLoadMemory = std::max(meshResults.peakLoadMemory, objex.getLoadStats().peakMemory);
+			if (fileAccess == Objex::FileAccess::MemoryMapped)
+			{
+				mappedLoad.seconds.push_back(seconds);
+				parse.seconds.push_back(objex.getLoadStats().parseTime);
+			}
+			else
+				bufferedLoad.seconds.push_back(seconds);
+		}
+	}
+
+	{
+		std::ifstream file(mesh.filename, std::ifstream::in | std::ifstream::binary);
+		const std::vector<char> data{ std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>() };
+		for (unsigned int run{ 0u }; run < runs; ++run)
+		{
+			Objex objex;
+			const auto start = std::chrono::steady_clock::now();
+			if (!objex.loadFromMemory(data.data(), data.size(), loadOptions))
+			{
+				std::cerr << "Failed to load " << mesh.filename << " from memory" << std::endl;
+				return false;
+			}
+			memoryLoad.seconds.push_back(getSeconds(start));
+		}
+	}
+
+	Objex objex;
+	loadOptions.fileAccess = Objex::FileAccess::MemoryMapped;
+	if (!objex.loadFromFile(mesh.filename, loadOptions))
+		return false;
+	const unsigned int numberOfVertices{ static_cast<unsigned int>(objex.viewAllVertices().size()) };
+	for (unsigned int run{ 0u }; run < runs; ++run)
+	{
+		auto start = std::chrono::steady_clock::now();
+		objex.refreshData();
+		refresh.seconds.push_back(getSeconds(start));
+
+		start = std::chrono::steady_clock::now();
+		objex.scale((run % 2u == 0u) ? 2.f : 0.5f);
+		scale.seconds.push_back(getSeconds(start));
+
+		// every vertex is moved (and moved back by the next run)
+		const float offset{ (run % 2u == 0u) ? 0.001f : -0.001f };
+		start = std::chrono::steady_clock::now();
+		for (unsigned int vertexNumber{ 0u }; vertexNumber < numberOfVertices; ++vertexNumber)
+		{
+			Objex::Vertex vertex{ objex.getVertex(vertexNumber) };
+			vertex.y += offset;
+			objex.setVertex(vertexNumber, vertex);
+		}
+		objex.refreshChangedData();
+		setVertex.seconds.push_back(getSeconds(start));
+
+		// the first vertex is on the edge of the bounding box so setting it requires the box to be recalculated
+		Objex::Vertex first{ objex.getVertex(0u) };
+		objex.setVertex(0u, first);
+		start = std::chrono::steady_clock::now();
+		objex.getLocalBoundingBox();
+		bounds.seconds.push_back(getSeconds(start));
+		objex.refreshChangedData();
+	}
+
+	meshResults.mesh = mesh;
+	meshResults.results = { mappedLoad, bufferedLoad, parse, memoryLoad, refresh, scale, setVertex, bounds };
+	meshResults.peakResidentSetSize = getPeakResidentSetSize();
+	return true;
+}
+
+std::vector<unsigned long long> parseFaceCounts(const std::string& text)
+{
+	std::vector<unsigned long long> faceCounts;
+	std::stringstream stream(text);
+	std::string count;
+	while (std::getline(stream, count, ','))
+	{
+		const unsigned long long faces{ std::strtoull(count.c_str(), nullptr, 10) };
+		if (faces > 0u)
+			faceCounts.push_back(faces);
+	}
+	return faceCounts;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+	std::vector<unsigned long long> faceCounts{ 10000u, 100000u, 1000000u };
+	unsigned int runs{ 5u };
+	unsigned int threads{ 1u };
+	std::string directory{ "." };
+	std::string outputFilename; // empty writes to the standard output
+	bool keepFiles{ false };
+	for (int argument{ 1 }; argument < argc; ++argument)
+	{
+		const std::string option{ argv[argument] };
+		const bool hasValue{ argument + 1 < argc };
+		if ((option == "--faces") && hasValue)
+			faceCounts = parseFaceCounts(argv[++argument]);
+		else if ((option == "--runs") && hasValue)
+			runs = std::max(static_cast<unsigned int>(std::strtoul(argv[++argument], nullptr, 10)), 1u);
+		else if ((option == "--threads") && hasValue)
+			threads = static_cast<unsigned int>(std::strtoul(argv[++argument], nullptr, 10));
+		else if ((option == "--directory") && hasValue)
+			directory = argv[++argument];
+		else if ((option == "--output") && hasValue)
+			outputFilename = argv[++argument];
+		else if (option == "--keep-files")
+			keepFiles = true;
+		else
+		{
+			std::cerr << "Usage: benchmark [--faces 10000,100000,1000000] [--runs 5] [--threads 1] [--directory .] [--output results.json] [--keep-files]" << std::endl;
+			return EXIT_FAILURE;
+		}
+	}
+
+	std::vector<MeshResults> meshResults;
+	for (const auto faces : faceCounts)
+	{
+		const std::vector<MeshSpecification> specifications
+		{
+			{ "grid-triangles", Shape::Grid, faces, false, false, false, false },
+			{ "grid-triangles-normals-textures", Shape::Grid, faces, true, true, false, false },
+			{ "grid-quads-normals-textures", Shape::Grid, faces, true, true, true, false },
+			{ "grid-triangles-normals-textures-relative", Shape::Grid, faces, true, true, false, true },
+			{ "sphere-triangles-normals", Shape::Sphere, faces, true, false, false, false },
+			{ "sphere-quads-normals-textures", Shape::Sphere, faces, true, true, true, false }
+		};
+		for (const auto& specification : specifications)
+		{
+			const std::string name{ specification.name + "-" + std::to_string(faces) };
+			const std::string filename{ directory + "/objex-benchmark-" + name + ".obj" };
+			std::clog << "Benchmarking " << name << std::endl;
+			GeneratedMesh mesh;
+			if (!generateMesh(specification, filename, mesh))
+			{
+				std::cerr << "Failed to write " << filename << std::endl;
+				return EXIT_FAILURE;
+			}
+			meshResults.emplace_back();
+			meshResults.back().name = name;
+			const bool isBenchmarked{ benchmarkMesh(mesh, runs, threads, meshResults.back()) };
+			if (!keepFiles)
+				std::remove(filename.c_str());
+			if (!isBenchmarked)
+				return EXIT_FAILURE;
+		}
+	}
+
+	if (outputFilename.empty())
+		writeJson(std::cout, meshResults, runs, threads);
+	else
+	{
+		std::ofstream output(outputFilename);
+		if (!output.is_open())
+		{
+			std::cerr << "Failed to write " << outputFilename << std::endl;
+			return EXIT_FAILURE;
+		}
+		writeJson(output, meshResults, runs, threads);
+	}
+	return EXIT_SUCCESS;
+}
@@ -11,7 +11,9 @@ int main()
 	DEV::KeepConsoleOpenSFML keepConsoleOpen;
 
 	Objex objex;
-	if (!objex.loadFromFile("cow-nonormals.obj")) // .OBJ file
+	Objex::LoadOptions loadOptions;
+	loadOptions.generateMissingNormals = true; // the cow has no normals
+	if (!objex.loadFromFile("cow-nonormals.obj", loadOptions)) // .OBJ file
 	{
 		std::cerr << "Failed to load obj." << std::endl;
 		return EXIT_FAILURE;
@@ -40,22 +42,22 @@ int main()
 
 	std::string textString{ "Nothing to display." };
 
-	if (objex.getUnprocessedLines().size() >= 1)
+	if (objex.viewUnprocessedLines().size() >= 1)
 	{
 		textString = "UNPROCESSED LINES:\n";
 		unsigned int lineNumber{ 0 };
-		for (auto line : objex.getUnprocessedLines())
+		for (const auto& line : objex.viewUnprocessedLines())
 		{
 			++lineNumber;
 			textString += std::to_string(lineNumber) + ":" + line + "\n";
 		}
 	}
 
-	if (objex.getCommentLines().size() >= 1)
+	if (objex.viewCommentLines().size() >= 1)
 	{
 		textString = "COMMENT LINES:\n";
 		unsigned int lineNumber{ 0 };
-		for (auto line : objex.getCommentLines())
+		for (const auto& line : objex.viewCommentLines())
 		{
 			++lineNumber;
 			textString += std::to_string(lineNumber) + ":" + line + "\n";
@@ -113,30 +115,30 @@ int main()
 		if (sf::Keyboard::isKeyPressed(sf::Keyboard::Right))
 		{
 			srand(0);
-			for (unsigned int vertexNumber{ 0 }; vertexNumber < objex.getAllVertices().size() - 1; ++vertexNumber)
+			std::vector<Objex::Vertex> vertices(objex.viewAllVertices().begin(), objex.viewAllVertices().end());
+			for (auto& v : vertices)
 			{
-				Objex::Vertex v;
-				v = objex.getVertex(vertexNumber);
 				v.x += rand() % 10;
 				v.y += rand() % 10;
 				v.z += rand() % 10;
-				objex.setVertex(vertexNumber, v);
 			}
-			objex.refreshData();
+			objex.beginEdit();
+			objex.setVertices(0, vertices.data(), vertices.size());
+			objex.commitEdit();
 		}
 		else if (sf::Keyboard::isKeyPressed(sf::Keyboard::Left))
 		{
 			srand(0);
-			for (unsigned int vertexNumber{ 0 }; vertexNumber < objex.getAllVertices().size() - 1; ++vertexNumber)
+			std::vector<Objex::Vertex> vertices(objex.viewAllVertices().begin(), objex.viewAllVertices().end());
+			for (auto& v : vertices)
 			{
-				Objex::Vertex v;
-				v = objex.getVertex(vertexNumber);
 				v.x -= rand() % 10;
 				v.y -= rand() % 10;
 				v.z -= rand() % 10;
-				objex.setVertex(vertexNumber, v);
 			}
-			objex.refreshData();
+			objex.beginEdit();
+			objex.setVertices(0, vertices.data(), vertices.size());
+			objex.commitEdit();
 		}
 
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
@@ -152,7 +154,14 @@ int main()
 		glRotatef(clock.getElapsedTime().asSeconds() * 30, 0.f, 1.f, 0.f);
 		glRotatef(clock.getElapsedTime().asSeconds() * 90, 0.f, 0.f, 1.f);
 
-		glDrawArrays(GL_TRIANGLES, 0, objex.getNumberOfVertices());
+		// one draw per material (material state would be set before each)
+		for (const auto& submesh : objex.viewSubmeshes())
+		{
+			if (objex.getOutputOptions().indexed)
+				glDrawElements(GL_TRIANGLES, submesh.count, objex.getIndexType(), static_cast<const char*>(objex.indexData) + submesh.first * ((objex.getIndexType() == GL_UNSIGNED_SHORT) ? sizeof(GLushort) : sizeof(GLuint)));
+			else
+				glDrawArrays(GL_TRIANGLES, submesh.first, submesh.count);
+		}
 
 
 